@@ -0,0 +1,1385 @@
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "blob.h"
+#include "bqueue.h"
+#include "lfqueue.h"
+#include "lru.h"
+#include "mqueue.h"
+#include "queue.h"
+#include "spsc.h"
+#include "tlqueue.h"
+#include "tqueue.h"
+#include "wsdeque.h"
+
+/* Room for a sequence number and a timestamp */
+#define ITEM_LEN 48
+
+/******** Utility Zone ********/
+
+static inline uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void make_item(char *buf, long id)
+{
+    snprintf(buf, ITEM_LEN, "%ld %" PRIu64, id, now_ns());
+}
+
+/* Totals gathered by one consumer, merged once it is done */
+typedef struct {
+    long items;
+    uint64_t id_sum;
+    uint64_t id_sq_sum;
+    uint64_t latency_sum;
+    uint64_t latency_max;
+} tally_t;
+
+static void tally_item(tally_t *t, const char *item)
+{
+    char *end;
+    uint64_t id = strtoul(item, &end, 10);
+    uint64_t latency = now_ns() - strtoull(end, NULL, 10);
+
+    t->items++;
+    t->id_sum += id;
+    t->id_sq_sum += id * id;
+    t->latency_sum += latency;
+    if (latency > t->latency_max)
+        t->latency_max = latency;
+}
+
+static void merge_tally(tally_t *into, const tally_t *t)
+{
+    into->items += t->items;
+    into->id_sum += t->id_sum;
+    into->id_sq_sum += t->id_sq_sum;
+    into->latency_sum += t->latency_sum;
+    if (t->latency_max > into->latency_max)
+        into->latency_max = t->latency_max;
+}
+
+/* Fill res from the merged tally of items 0 to n-1 */
+static void finish_result(bench_result_t *res,
+                          const tally_t *t,
+                          long n,
+                          double seconds)
+{
+    /* Sums of the ids and of their squares tell missing or repeated items */
+    uint64_t m = n;
+    res->ok = t->items == n && t->id_sum == m * (m - 1) / 2 &&
+              t->id_sq_sum == (m - 1) * m * (2 * m - 1) / 6;
+    res->items = t->items;
+    res->seconds = seconds;
+    res->avg_latency = t->items ? t->latency_sum / 1e3 / t->items : 0;
+    res->max_latency = t->latency_max / 1e3;
+}
+
+/*
+ * Start count threads running fn on consecutive elements of args, each
+ * size bytes long.  The threads inherit a mask blocking every signal.
+ * Return number of threads started.
+ */
+static int spawn(pthread_t *tids,
+                 int count,
+                 void *(*fn)(void *),
+                 void *args,
+                 size_t size)
+{
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+
+    int started = 0;
+    while (started < count &&
+           !pthread_create(&tids[started], NULL, fn,
+                           (char *) args + started * size))
+        started++;
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    return started;
+}
+
+static void join(pthread_t *tids, int count)
+{
+    for (int i = 0; i < count; i++)
+        pthread_join(tids[i], NULL);
+}
+
+/* Keep the calling thread on one CPU, when the machine has that many */
+static void pin(int cpu)
+{
+    if (cpu >= sysconf(_SC_NPROCESSORS_ONLN))
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * Busy-wait for the other side of a lock-free hand-off, giving the CPU
+ * away now and then in case it runs on the same one.
+ * Return false if the workload was called off meanwhile.
+ */
+static inline bool spin(int *spins, const bool *stop)
+{
+    if (++*spins % 64 == 0)
+        sched_yield();
+    return !__atomic_load_n(stop, __ATOMIC_RELAXED);
+}
+
+/******** End of Utility Zone ********/
+
+/* Blocking queue workload */
+
+typedef struct {
+    bqueue_t *bq;
+    long first; /* Ids first, first + stride, ... below n */
+    long stride;
+    long n;
+    int batch;
+    tally_t tally;
+} bq_worker_t;
+
+static void *bq_produce(void *arg)
+{
+    bq_worker_t *w = arg;
+    char bufs[w->batch][ITEM_LEN];
+    char *vals[w->batch];
+    for (int i = 0; i < w->batch; i++)
+        vals[i] = bufs[i];
+
+    long id = w->first;
+    while (id < w->n) {
+        int cnt = 0;
+        for (; cnt < w->batch && id < w->n; cnt++, id += w->stride)
+            make_item(bufs[cnt], id);
+
+        if (cnt == 1) {
+            while (!bq_push(w->bq, vals[0]))
+                ;
+        } else {
+            for (int done = 0; done < cnt;)
+                done += bq_push_batch(w->bq, vals + done, cnt - done);
+        }
+    }
+
+    return NULL;
+}
+
+static void *bq_consume(void *arg)
+{
+    bq_worker_t *w = arg;
+    char item[ITEM_LEN];
+    while (true) {
+        bq_status_t status = bq_pop_wait(w->bq, item, sizeof(item), 100);
+        if (status == BQ_CLOSED)
+            break;
+        if (status == BQ_OK)
+            tally_item(&w->tally, item);
+    }
+
+    return NULL;
+}
+
+bool bench_bqueue(int producers,
+                  int consumers,
+                  long n,
+                  int batch,
+                  int capacity,
+                  bench_result_t *res)
+{
+    bqueue_t *bq = bq_new();
+    pthread_t *tids = malloc((producers + consumers) * sizeof(pthread_t));
+    bq_worker_t *ws = calloc(producers + consumers, sizeof(bq_worker_t));
+    if (!bq || !tids || !ws) {
+        bq_free(bq);
+        free(tids);
+        free(ws);
+        return false;
+    }
+    if (capacity > 0)
+        bq_set_capacity(bq, capacity, false, Q_BLOCK);
+
+    for (int i = 0; i < producers + consumers; i++) {
+        ws[i].bq = bq;
+        ws[i].first = i;
+        ws[i].stride = producers;
+        ws[i].n = n;
+        ws[i].batch = batch;
+    }
+
+    uint64_t start = now_ns();
+    int started = spawn(tids + producers, consumers, bq_consume,
+                        ws + producers, sizeof(bq_worker_t));
+    bool ok = started == consumers;
+    if (ok) {
+        int made = spawn(tids, producers, bq_produce, ws,
+                         sizeof(bq_worker_t));
+        ok = made == producers;
+        join(tids, made);
+    }
+    bq_close(bq);
+    join(tids + producers, started);
+    double seconds = (now_ns() - start) / 1e9;
+
+    tally_t total = {0};
+    for (int i = producers; i < producers + consumers; i++)
+        merge_tally(&total, &ws[i].tally);
+    finish_result(res, &total, n, seconds);
+
+    bq_free(bq);
+    free(tids);
+    free(ws);
+
+    return ok;
+}
+
+/* Insert-remove pairs workload */
+
+typedef struct {
+    void *queue;
+    long first; /* Ids first, first + stride, ... below n */
+    long stride;
+    long n;
+    tally_t tally;
+} pair_worker_t;
+
+static void *lfq_pairs(void *arg)
+{
+    pair_worker_t *w = arg;
+    lfq_handle_t *h = lfq_attach(w->queue);
+    if (!h)
+        return NULL;
+
+    char item[ITEM_LEN];
+    for (long id = w->first; id < w->n; id += w->stride) {
+        make_item(item, id);
+        while (!lfq_insert_tail(w->queue, h, item))
+            ;
+        if (lfq_remove_head(w->queue, h, item, sizeof(item)))
+            tally_item(&w->tally, item);
+    }
+    lfq_detach(w->queue, h);
+
+    return NULL;
+}
+
+static void *bq_pairs(void *arg)
+{
+    pair_worker_t *w = arg;
+    char item[ITEM_LEN];
+    for (long id = w->first; id < w->n; id += w->stride) {
+        make_item(item, id);
+        while (!bq_push(w->queue, item))
+            ;
+        if (bq_pop_wait(w->queue, item, sizeof(item), 0) == BQ_OK)
+            tally_item(&w->tally, item);
+    }
+
+    return NULL;
+}
+
+/* Run the pairs workload with fn, then let drain collect what is left */
+static bool run_pairs(void *queue,
+                      void *(*fn)(void *),
+                      int threads,
+                      long n,
+                      tally_t *total)
+{
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    pair_worker_t *ws = calloc(threads, sizeof(pair_worker_t));
+    if (!tids || !ws) {
+        free(tids);
+        free(ws);
+        return false;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        ws[i].queue = queue;
+        ws[i].first = i;
+        ws[i].stride = threads;
+        ws[i].n = n;
+    }
+
+    int started = spawn(tids, threads, fn, ws, sizeof(pair_worker_t));
+    join(tids, started);
+    for (int i = 0; i < started; i++)
+        merge_tally(total, &ws[i].tally);
+
+    free(tids);
+    free(ws);
+
+    return started == threads;
+}
+
+bool bench_lfqueue(int threads,
+                   long n,
+                   bench_result_t *lockfree,
+                   bench_result_t *locked)
+{
+    char item[ITEM_LEN];
+
+    lfqueue_t *lfq = lfq_new();
+    if (!lfq)
+        return false;
+
+    tally_t total = {0};
+    uint64_t start = now_ns();
+    bool ok = run_pairs(lfq, lfq_pairs, threads, n, &total);
+    double seconds = (now_ns() - start) / 1e9;
+
+    lfq_handle_t *h = lfq_attach(lfq);
+    while (h && lfq_remove_head(lfq, h, item, sizeof(item)))
+        tally_item(&total, item);
+    if (h)
+        lfq_detach(lfq, h);
+    lfq_free(lfq);
+    finish_result(lockfree, &total, n, seconds);
+    if (!ok || !h)
+        return false;
+
+    bqueue_t *bq = bq_new();
+    if (!bq)
+        return false;
+
+    memset(&total, 0, sizeof(total));
+    start = now_ns();
+    ok = run_pairs(bq, bq_pairs, threads, n, &total);
+    seconds = (now_ns() - start) / 1e9;
+
+    while (bq_pop_wait(bq, item, sizeof(item), 0) == BQ_OK)
+        tally_item(&total, item);
+    bq_free(bq);
+    finish_result(locked, &total, n, seconds);
+
+    return ok;
+}
+
+/* Single-producer/single-consumer ring workload */
+
+/* Only every so many items carries a timestamp, to keep clocks out */
+#define SPSC_STAMP_EVERY 64
+
+/* Item handed over by pointer: nothing is formatted, parsed or allocated */
+typedef struct {
+    long id;
+    uint64_t stamp; /* Production time, or 0 */
+} spsc_item_t;
+
+typedef struct {
+    spsc_t *r;
+    long n;
+    int batch;
+    bool copy;          /* Use the copying interface instead of pointers */
+    spsc_item_t *items; /* Pool the pointers refer to */
+    long pool;          /* Number of items in the pool */
+    bool *stop;         /* Set if the other thread never started */
+    bool ordered;       /* Consumer saw ids in production order */
+    tally_t tally;
+} spsc_worker_t;
+
+static void *spsc_produce(void *arg)
+{
+    spsc_worker_t *w = arg;
+    pin(0);
+
+    if (w->copy) {
+        char item[ITEM_LEN];
+        for (long id = 0; id < w->n; id++) {
+            make_item(item, id);
+            for (int spins = 0; !spsc_insert_tail(w->r, item);) {
+                if (!spin(&spins, w->stop))
+                    return NULL;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+     * A pool slot is reused pool items later, by which time neither the
+     * batch being filled, the ring, nor the batch being consumed hold its
+     * previous item.
+     */
+    char *vals[w->batch];
+    long id = 0;
+    while (id < w->n) {
+        int cnt = 0;
+        for (; cnt < w->batch && id < w->n; cnt++, id++) {
+            spsc_item_t *item = &w->items[id % w->pool];
+            item->id = id;
+            item->stamp = id % SPSC_STAMP_EVERY ? 0 : now_ns();
+            vals[cnt] = (char *) item;
+        }
+
+        int spins = 0;
+        for (int done = 0; done < cnt;) {
+            int pushed = spsc_push_batch(w->r, vals + done, cnt - done);
+            if (!pushed && !spin(&spins, w->stop))
+                return NULL;
+            done += pushed;
+        }
+    }
+
+    return NULL;
+}
+
+static void *spsc_consume(void *arg)
+{
+    spsc_worker_t *w = arg;
+    pin(1);
+
+    if (w->copy) {
+        char item[ITEM_LEN];
+        for (long got = 0; got < w->n; got++) {
+            for (int spins = 0;
+                 !spsc_remove_head(w->r, item, sizeof(item));) {
+                if (!spin(&spins, w->stop))
+                    return NULL;
+            }
+            tally_item(&w->tally, item);
+        }
+        return NULL;
+    }
+
+    char *vals[w->batch];
+    tally_t *t = &w->tally;
+    w->ordered = true;
+    while (t->items < w->n) {
+        int cnt, spins = 0;
+        while (!(cnt = spsc_pop_batch(w->r, vals, w->batch))) {
+            if (!spin(&spins, w->stop))
+                return NULL;
+        }
+
+        for (int i = 0; i < cnt; i++) {
+            spsc_item_t *item = (spsc_item_t *) vals[i];
+            uint64_t id = item->id;
+            if (id != (uint64_t) t->items)
+                w->ordered = false;
+            t->items++;
+            t->id_sum += id;
+            t->id_sq_sum += id * id;
+            if (!item->stamp)
+                continue;
+
+            uint64_t latency = now_ns() - item->stamp;
+            t->latency_sum += latency * SPSC_STAMP_EVERY;
+            if (latency > t->latency_max)
+                t->latency_max = latency;
+        }
+    }
+
+    return NULL;
+}
+
+bool bench_spsc(long n, int capacity, int batch, bool copy, bench_result_t *res)
+{
+    spsc_t *r = spsc_new(capacity);
+    pthread_t tids[2];
+    bool stop = false;
+    spsc_worker_t ws[2] = {
+        {.r = r, .n = n, .batch = batch, .copy = copy, .stop = &stop},
+    };
+    ws[0].pool = r ? r->mask + 1 + 2 * batch : 0;
+    ws[0].items = copy ? NULL : malloc(ws[0].pool * sizeof(spsc_item_t));
+    if (!r || (!copy && !ws[0].items)) {
+        spsc_free(r);
+        free(ws[0].items);
+        return false;
+    }
+    ws[1] = ws[0];
+
+    uint64_t start = now_ns();
+    int started = spawn(tids, 1, spsc_produce, ws, sizeof(spsc_worker_t));
+    if (started) {
+        started += spawn(tids + 1, 1, spsc_consume, ws + 1,
+                         sizeof(spsc_worker_t));
+    }
+    /* Without a consumer the producer would spin for ever */
+    if (started < 2)
+        __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    join(tids, started);
+    double seconds = (now_ns() - start) / 1e9;
+
+    finish_result(res, &ws[1].tally, n, seconds);
+    if (!copy)
+        res->ok = res->ok && ws[1].ordered;
+
+    /* Pointers into the pool left behind must not be freed with the ring */
+    if (!copy)
+        r->head = r->tail;
+    spsc_free(r);
+    free(ws[0].items);
+
+    return started == 2;
+}
+
+/* Mixed producer/consumer workload over polled queues */
+
+typedef struct {
+    bool (*insert)(void *queue, char *s);
+    bool (*remove)(void *queue, char *sp, size_t bufsize);
+} queue_ops_t;
+
+static bool tlq_insert(void *queue, char *s)
+{
+    return tlq_insert_tail(queue, s);
+}
+
+static bool tlq_remove(void *queue, char *sp, size_t bufsize)
+{
+    return tlq_remove_head(queue, sp, bufsize);
+}
+
+static bool bq_insert(void *queue, char *s)
+{
+    return bq_push(queue, s);
+}
+
+static bool bq_remove(void *queue, char *sp, size_t bufsize)
+{
+    return bq_pop_wait(queue, sp, bufsize, 0) == BQ_OK;
+}
+
+static const queue_ops_t tlq_ops = {tlq_insert, tlq_remove};
+static const queue_ops_t bq_ops = {bq_insert, bq_remove};
+
+typedef struct {
+    void *queue;
+    const queue_ops_t *ops;
+    long first; /* Producers: ids first, first + stride, ... below n */
+    long stride;
+    long n;
+    long *left; /* Items not consumed yet */
+    bool *stop; /* Set if not every thread started */
+    tally_t tally;
+} mixed_worker_t;
+
+static void *mixed_produce(void *arg)
+{
+    mixed_worker_t *w = arg;
+    char item[ITEM_LEN];
+    for (long id = w->first; id < w->n; id += w->stride) {
+        make_item(item, id);
+        for (int spins = 0; !w->ops->insert(w->queue, item);) {
+            if (!spin(&spins, w->stop))
+                return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static void *mixed_consume(void *arg)
+{
+    mixed_worker_t *w = arg;
+    char item[ITEM_LEN];
+    int spins = 0;
+    while (__atomic_load_n(w->left, __ATOMIC_RELAXED) > 0) {
+        if (!w->ops->remove(w->queue, item, sizeof(item))) {
+            if (!spin(&spins, w->stop))
+                break;
+            continue;
+        }
+
+        tally_item(&w->tally, item);
+        __atomic_fetch_sub(w->left, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static bool run_mixed(void *queue,
+                      const queue_ops_t *ops,
+                      int producers,
+                      int consumers,
+                      long n,
+                      bench_result_t *res)
+{
+    int threads = producers + consumers;
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    mixed_worker_t *ws = calloc(threads, sizeof(mixed_worker_t));
+    if (!tids || !ws) {
+        free(tids);
+        free(ws);
+        return false;
+    }
+
+    long left = n;
+    bool stop = false;
+    for (int i = 0; i < threads; i++) {
+        ws[i].queue = queue;
+        ws[i].ops = ops;
+        ws[i].first = i;
+        ws[i].stride = producers;
+        ws[i].n = n;
+        ws[i].left = &left;
+        ws[i].stop = &stop;
+    }
+
+    uint64_t start = now_ns();
+    int started = spawn(tids + producers, consumers, mixed_consume,
+                        ws + producers, sizeof(mixed_worker_t));
+    int made = 0;
+    if (started == consumers)
+        made = spawn(tids, producers, mixed_produce, ws,
+                     sizeof(mixed_worker_t));
+    if (started < consumers || made < producers)
+        __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    join(tids, made);
+    join(tids + producers, started);
+    double seconds = (now_ns() - start) / 1e9;
+
+    tally_t total = {0};
+    for (int i = producers; i < producers + started; i++)
+        merge_tally(&total, &ws[i].tally);
+    finish_result(res, &total, n, seconds);
+
+    free(tids);
+    free(ws);
+
+    return started == consumers && made == producers;
+}
+
+bool bench_tlqueue(int producers,
+                   int consumers,
+                   long n,
+                   bench_result_t *two_lock,
+                   bench_result_t *one_lock)
+{
+    tlqueue_t *tlq = tlq_new();
+    if (!tlq)
+        return false;
+
+    bool ok = run_mixed(tlq, &tlq_ops, producers, consumers, n, two_lock);
+    tlq_free(tlq);
+    if (!ok)
+        return false;
+
+    bqueue_t *bq = bq_new();
+    if (!bq)
+        return false;
+
+    ok = run_mixed(bq, &bq_ops, producers, consumers, n, one_lock);
+    bq_free(bq);
+
+    return ok;
+}
+
+/* Work-stealing pool sorting strings */
+
+/* Ranges this short are sorted by a single qsort call */
+#define SORT_CUTOFF 2048
+
+struct worker;
+
+typedef struct task {
+    void (*run)(struct task *t, struct worker *w);
+    int done;
+} task_t;
+
+typedef struct worker {
+    wsdeque_t *dq;
+    struct worker *all; /* Every worker of the pool */
+    int count;
+    int id;
+    uint32_t seed; /* Picks the victims */
+    bool *quit;
+    long executed;
+    long stolen;
+} worker_t;
+
+/* Own tasks first, newest first, then the oldest task of a random victim */
+static task_t *find_task(worker_t *w)
+{
+    task_t *t = wsq_pop(w->dq);
+    if (t || w->count == 1)
+        return t;
+
+    /* xorshift32 */
+    w->seed ^= w->seed << 13;
+    w->seed ^= w->seed >> 17;
+    w->seed ^= w->seed << 5;
+    int victim = w->seed % (w->count - 1);
+    if (victim >= w->id)
+        victim++;
+
+    void *item;
+    if (wsq_steal(w->all[victim].dq, &item) != WSQ_OK)
+        return NULL;
+
+    w->stolen++;
+    return item;
+}
+
+static void execute(task_t *t, worker_t *w)
+{
+    t->run(t, w);
+    w->executed++;
+    __atomic_store_n(&t->done, 1, __ATOMIC_RELEASE);
+}
+
+/* Wait for t to be done, running other tasks meanwhile */
+static void wait_task(task_t *t, worker_t *w)
+{
+    int spins = 0;
+    bool never = false;
+    while (!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) {
+        task_t *other = find_task(w);
+        if (other)
+            execute(other, w);
+        else
+            spin(&spins, &never);
+    }
+}
+
+static void *work(void *arg)
+{
+    worker_t *w = arg;
+    int spins = 0;
+    while (true) {
+        task_t *t = find_task(w);
+        if (t)
+            execute(t, w);
+        else if (!spin(&spins, w->quit))
+            break;
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    task_t task;
+    char **vals;
+    char **tmp; /* Scratch space as long as vals */
+    long n;
+} sort_task_t;
+
+static int cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void sort_run(task_t *t, worker_t *w)
+{
+    sort_task_t *st = (sort_task_t *) t;
+    if (st->n <= SORT_CUTOFF) {
+        qsort(st->vals, st->n, sizeof(char *), cmp_str);
+        return;
+    }
+
+    /* Offer the right half to thieves and sort the left half meanwhile */
+    long half = st->n / 2;
+    sort_task_t left = {{sort_run, 0}, st->vals, st->tmp, half};
+    sort_task_t right = {{sort_run, 0}, st->vals + half, st->tmp + half,
+                         st->n - half};
+    if (wsq_push(w->dq, &right.task)) {
+        execute(&left.task, w);
+        wait_task(&right.task, w);
+    } else {
+        execute(&left.task, w);
+        execute(&right.task, w);
+    }
+
+    char **a = st->vals, **b = st->vals + half;
+    char **a_end = b, **b_end = st->vals + st->n;
+    char **m = st->tmp;
+    while (a < a_end && b < b_end)
+        *m++ = strcmp(*a, *b) <= 0 ? *a++ : *b++;
+    while (a < a_end)
+        *m++ = *a++;
+    while (b < b_end)
+        *m++ = *b++;
+    memcpy(st->vals, st->tmp, st->n * sizeof(char *));
+}
+
+bool bench_wssort(int threads,
+                  long n,
+                  bench_result_t *res,
+                  long *executed,
+                  long *stolen)
+{
+    char **vals = malloc(n * sizeof(char *));
+    char **tmp = malloc(n * sizeof(char *));
+    char *text = malloc(n * ITEM_LEN);
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    worker_t *ws = calloc(threads, sizeof(worker_t));
+    bool quit = false;
+    bool ok = vals && tmp && text && tids && ws;
+    for (int i = 0; ok && i < threads; i++) {
+        ws[i].dq = wsq_new(64);
+        ws[i].all = ws;
+        ws[i].count = threads;
+        ws[i].id = i;
+        ws[i].seed = 2463534242U + i;
+        ws[i].quit = &quit;
+        ok = ws[i].dq != NULL;
+    }
+
+    int started = 0;
+    if (ok) {
+        /* Zero-padded ids sort like numbers, shuffled by Fisher-Yates */
+        for (long i = 0; i < n; i++) {
+            vals[i] = text + i * ITEM_LEN;
+            snprintf(vals[i], ITEM_LEN, "%012ld", i);
+        }
+        uint32_t seed = 88172645U;
+        for (long i = n - 1; i > 0; i--) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            long j = seed % (i + 1);
+            char *v = vals[i];
+            vals[i] = vals[j];
+            vals[j] = v;
+        }
+
+        /* The calling thread acts as worker 0 */
+        uint64_t start = now_ns();
+        started = spawn(tids + 1, threads - 1, work, ws + 1, sizeof(worker_t));
+        sort_task_t root = {{sort_run, 0}, vals, tmp, n};
+        execute(&root.task, &ws[0]);
+        __atomic_store_n(&quit, true, __ATOMIC_RELAXED);
+        join(tids + 1, started);
+        res->seconds = (now_ns() - start) / 1e9;
+        started++;
+
+        res->items = n;
+        res->ok = true;
+        for (long i = 0; i < n; i++) {
+            if (strtol(vals[i], NULL, 10) != i)
+                res->ok = false;
+        }
+        res->avg_latency = 0;
+        res->max_latency = 0;
+
+        for (int i = 0; i < threads; i++) {
+            executed[i] = ws[i].executed;
+            stolen[i] = ws[i].stolen;
+        }
+    }
+
+    for (int i = 0; ws && i < threads; i++)
+        wsq_free(ws[i].dq);
+    free(ws);
+    free(tids);
+    free(text);
+    free(tmp);
+    free(vals);
+
+    return ok && started == threads;
+}
+
+/* Sharded relaxed queue workload */
+
+static void *mq_pairs(void *arg)
+{
+    pair_worker_t *w = arg;
+    uint32_t seed = 2463534242U + w->first;
+    char item[ITEM_LEN];
+    for (long id = w->first; id < w->n; id += w->stride) {
+        make_item(item, id);
+        while (!mq_insert(w->queue, &seed, item))
+            ;
+        if (mq_remove(w->queue, &seed, item, sizeof(item)))
+            tally_item(&w->tally, item);
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    mqueue_t *mq;
+    long *log; /* Ids in the order they were removed */
+    long *next; /* Next free entry of log */
+    long first;
+    tally_t tally;
+} drain_worker_t;
+
+static void *mq_drain(void *arg)
+{
+    drain_worker_t *w = arg;
+    uint32_t seed = 88172645U + w->first;
+    char item[ITEM_LEN];
+    while (mq_remove(w->mq, &seed, item, sizeof(item))) {
+        long at = __atomic_fetch_add(w->next, 1, __ATOMIC_RELAXED);
+        w->log[at] = strtol(item, NULL, 10);
+        tally_item(&w->tally, item);
+    }
+
+    return NULL;
+}
+
+/*
+ * Rank error of each removal: the number of elements still present that
+ * were inserted before the one removed, counted with a Fenwick tree over
+ * the ids.
+ */
+static void rank_errors(const long *log, long n, double *mean, long *max)
+{
+    long *tree = calloc(n + 1, sizeof(long));
+    *mean = 0;
+    *max = 0;
+    if (!tree)
+        return;
+
+    for (long i = 1; i <= n; i++) {
+        tree[i]++;
+        long parent = i + (i & -i);
+        if (parent <= n)
+            tree[parent] += tree[i];
+    }
+
+    double sum = 0;
+    for (long k = 0; k < n; k++) {
+        long rank = 0;
+        for (long i = log[k]; i > 0; i -= i & -i)
+            rank += tree[i];
+        for (long i = log[k] + 1; i <= n; i += i & -i)
+            tree[i]--;
+
+        sum += rank;
+        if (rank > *max)
+            *max = rank;
+    }
+    *mean = sum / n;
+
+    free(tree);
+}
+
+bool bench_mqueue(int threads,
+                  int shards,
+                  long n,
+                  bench_result_t *sharded,
+                  bench_result_t *locked,
+                  double *mean_rank,
+                  long *max_rank)
+{
+    char item[ITEM_LEN];
+    uint32_t seed = 1;
+
+    /* Throughput: insert-remove pairs, then drain the rest */
+    mqueue_t *mq = mq_new(shards);
+    if (!mq)
+        return false;
+
+    tally_t total = {0};
+    uint64_t start = now_ns();
+    bool ok = run_pairs(mq, mq_pairs, threads, n, &total);
+    double seconds = (now_ns() - start) / 1e9;
+
+    while (mq_remove(mq, &seed, item, sizeof(item)))
+        tally_item(&total, item);
+    finish_result(sharded, &total, n, seconds);
+    if (!ok) {
+        mq_free(mq);
+        return false;
+    }
+
+    /* Ordering: fill in id order, then drain with every thread */
+    for (long id = 0; id < n; id++) {
+        make_item(item, id);
+        while (!mq_insert(mq, &seed, item))
+            ;
+    }
+
+    long *log = malloc(n * sizeof(long));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    drain_worker_t *ws = calloc(threads, sizeof(drain_worker_t));
+    long next = 0;
+    ok = log && tids && ws;
+    if (ok) {
+        for (int i = 0; i < threads; i++) {
+            ws[i].mq = mq;
+            ws[i].log = log;
+            ws[i].next = &next;
+            ws[i].first = i;
+        }
+        int started =
+            spawn(tids, threads, mq_drain, ws, sizeof(drain_worker_t));
+        join(tids, started);
+        ok = started == threads;
+    }
+
+    if (ok) {
+        total = (tally_t){0};
+        for (int i = 0; i < threads; i++)
+            merge_tally(&total, &ws[i].tally);
+        bench_result_t drained;
+        finish_result(&drained, &total, n, 0);
+        sharded->ok = sharded->ok && drained.ok;
+        if (drained.ok)
+            rank_errors(log, n, mean_rank, max_rank);
+    }
+    free(ws);
+    free(tids);
+    free(log);
+    mq_free(mq);
+    if (!ok)
+        return false;
+
+    /* Baseline: the same pairs through a single lock */
+    bqueue_t *bq = bq_new();
+    if (!bq)
+        return false;
+
+    total = (tally_t){0};
+    start = now_ns();
+    ok = run_pairs(bq, bq_pairs, threads, n, &total);
+    seconds = (now_ns() - start) / 1e9;
+
+    while (bq_pop_wait(bq, item, sizeof(item), 0) == BQ_OK)
+        tally_item(&total, item);
+    bq_free(bq);
+    finish_result(locked, &total, n, seconds);
+
+    return ok;
+}
+
+/* Small queue workload */
+
+/* Mean time of a new, insert x3, free cycle with value s */
+static bool small_cycles(long n, char *s, double *ns)
+{
+    uint64_t start = now_ns();
+    for (long i = 0; i < n; i++) {
+        queue_t *q = q_new();
+        bool ok = q && q_insert_tail(q, s) && q_insert_tail(q, s) &&
+                  q_insert_tail(q, s);
+        q_free(q);
+        if (!ok)
+            return false;
+    }
+    *ns = (double) (now_ns() - start) / n;
+
+    return true;
+}
+
+bool bench_small_queues(long n, double *inline_ns, double *spilled_ns)
+{
+    char spilled[Q_INLINE_LEN + 1];
+    memset(spilled, 'x', Q_INLINE_LEN);
+    spilled[Q_INLINE_LEN] = '\0';
+
+    return small_cycles(n, "dolphin", inline_ns) &&
+           small_cycles(n, spilled, spilled_ns);
+}
+
+/* LRU cache workload */
+
+#define KEY_LEN 16
+
+/* Draw a rank from the cumulative distribution cdf of n ranks */
+static int draw_rank(const double *cdf, int n, uint64_t *seed)
+{
+    /* xorshift64, scaled to [0, 1) */
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    double u = (*seed >> 11) * (1.0 / (UINT64_C(1) << 53));
+
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cdf[mid] > u)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+bool bench_lru(long n,
+               int keys,
+               int capacity,
+               double skew,
+               cache_result_t *res)
+{
+    double *cdf = malloc(keys * sizeof(double));
+    char(*names)[KEY_LEN] = malloc(keys * sizeof(*names));
+    lru_t *c = lru_new(capacity, false);
+    if (!cdf || !names || !c) {
+        free(cdf);
+        free(names);
+        lru_free(c);
+        return false;
+    }
+
+    /* Key of rank i is drawn with probability proportional to 1 / i^skew */
+    double sum = 0;
+    for (int i = 0; i < keys; i++) {
+        sum += 1 / pow(i + 1, skew);
+        cdf[i] = sum;
+        snprintf(names[i], KEY_LEN, "key%d", i);
+    }
+    for (int i = 0; i < keys; i++)
+        cdf[i] /= sum;
+
+    /* The values need not differ: only the lookups are measured */
+    char data[] = "value";
+    bool ok = true;
+    uint64_t seed = 88172645463325252ULL;
+    uint64_t start = now_ns();
+    for (long i = 0; ok && i < n; i++) {
+        char *key = names[draw_rank(cdf, keys, &seed)];
+        if (!lru_get(c, key))
+            ok = lru_put(c, key, data);
+    }
+    res->seconds = (now_ns() - start) / 1e9;
+    res->gets = c->hits + c->misses;
+    res->hits = c->hits;
+    res->evictions = c->evictions;
+
+    lru_free(c);
+    free(names);
+    free(cdf);
+
+    return ok;
+}
+
+/* Typed queue workload */
+
+/* Room for UINT64_MAX in decimal */
+#define U64_LEN 21
+
+static inline int cmp_u64(uint64_t a, uint64_t b)
+{
+    return (a > b) - (a < b);
+}
+
+QUEUE_DEFINE(u64q, uint64_t, cmp_u64)
+
+static inline uint64_t xorshift64(uint64_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* Whether both queues hold the same values in the same order */
+static bool same_values(u64q_t *tq, queue_t *q)
+{
+    list_ele_t *e = q->head;
+    for (u64q_ele_t *t = tq->head; t; t = t->next, e = e->next) {
+        if (!e || strtoull(e->value, NULL, 10) != t->value)
+            return false;
+    }
+
+    return !e;
+}
+
+bool bench_typed_queue(long n, phase_result_t *typed, phase_result_t *str)
+{
+    uint64_t *out = malloc(n * sizeof(uint64_t));
+    u64q_t *tq = u64q_new();
+    queue_t *q = q_new();
+    bool ok = out && tq && q;
+
+    uint64_t seed = 88172645463325252ULL;
+    uint64_t start = now_ns();
+    for (long i = 0; ok && i < n; i++) {
+        uint64_t v = xorshift64(&seed);
+        ok = i % 2 ? u64q_insert_tail(tq, v) : u64q_insert_head(tq, v);
+    }
+    typed->insert = (now_ns() - start) / 1e9;
+
+    /* Same values, formatted so that string order is numeric order */
+    seed = 88172645463325252ULL;
+    start = now_ns();
+    for (long i = 0; ok && i < n; i++) {
+        char buf[U64_LEN];
+        snprintf(buf, sizeof(buf), "%020" PRIu64, xorshift64(&seed));
+        ok = i % 2 ? q_insert_tail(q, buf) : q_insert_head(q, buf);
+    }
+    str->insert = (now_ns() - start) / 1e9;
+
+    if (ok) {
+        start = now_ns();
+        u64q_reverse(tq);
+        typed->reverse = (now_ns() - start) / 1e9;
+        start = now_ns();
+        q_reverse(q);
+        str->reverse = (now_ns() - start) / 1e9;
+        ok = same_values(tq, q);
+    }
+
+    if (ok) {
+        start = now_ns();
+        u64q_sort(tq);
+        typed->sort = (now_ns() - start) / 1e9;
+        start = now_ns();
+        q_sort(q);
+        str->sort = (now_ns() - start) / 1e9;
+        ok = same_values(tq, q);
+    }
+
+    if (ok) {
+        start = now_ns();
+        for (long i = 0; i < n; i++)
+            u64q_remove_head(tq, &out[i]);
+        typed->remove = (now_ns() - start) / 1e9;
+
+        start = now_ns();
+        for (long i = 0; ok && i < n; i++) {
+            char buf[U64_LEN];
+            q_remove_head(q, buf, sizeof(buf));
+            ok = strtoull(buf, NULL, 10) == out[i] &&
+                 (i == 0 || out[i - 1] <= out[i]);
+        }
+        str->remove = (now_ns() - start) / 1e9;
+        ok = ok && u64q_size(tq) == 0 && q_size(q) == 0;
+    }
+
+    q_free(q);
+    u64q_free(tq);
+    free(out);
+
+    return ok;
+}
+
+/* Locale sort workload */
+
+#define WORD_LEN 24
+
+bool bench_locale_sort(long n, double *keyed, double *naive)
+{
+    static const char letters[] = "aAbBcCdDeEfFgGhHiIjJkKlLmMnNoOpP";
+    queue_t *kq = q_new(), *nq = q_new();
+    bool ok = kq && nq;
+
+    uint64_t seed = 88172645463325252ULL;
+    for (long i = 0; ok && i < n; i++) {
+        char word[WORD_LEN];
+        int len = 4 + xorshift64(&seed) % (WORD_LEN - 5);
+        for (int j = 0; j < len; j++)
+            word[j] = letters[xorshift64(&seed) % (sizeof(letters) - 1)];
+        word[len] = '\0';
+        ok = q_insert_tail(kq, word) && q_insert_tail(nq, word);
+    }
+
+    if (ok) {
+        uint64_t start = now_ns();
+        q_sort_by(kq, Q_LOCALE);
+        *keyed = (now_ns() - start) / 1e9;
+        start = now_ns();
+        q_sort_by(nq, Q_COLLATE);
+        *naive = (now_ns() - start) / 1e9;
+
+        list_ele_t *a = kq->head, *b = nq->head;
+        while (ok && a && b) {
+            ok = !strcmp(a->value, b->value);
+            a = a->next;
+            b = b->next;
+        }
+        ok = ok && !a && !b;
+    }
+
+    q_free(kq);
+    q_free(nq);
+
+    return ok;
+}
+
+/* Mixed value size workload */
+
+/* Short values are a 16-digit sequence number, large ones start with it */
+#define SEQ_LEN 16
+/* Values this long, terminator included, go to the blob region */
+#define BLOB_THRESHOLD 1024
+/* Room the consumer reads each value into */
+#define READ_LEN 1024
+
+/*
+ * Run the workload through queues storing values on the heap, or in region
+ * b if non-NULL, with the large ones built in buf.
+ */
+static bool mixed_workload(long n,
+                           int pct,
+                           char *buf,
+                           blobs_t *b,
+                           blob_result_t *res)
+{
+    queue_t *q = q_new();
+    bool ok = q && (!b || q_use_blobs(q, b, BLOB_THRESHOLD));
+
+    uint64_t start = now_ns();
+    for (long i = 0; ok && i < n; i++) {
+        char seq[SEQ_LEN + 1];
+        snprintf(seq, sizeof(seq), "%016lx", i);
+        if (i % 100 < pct) {
+            memcpy(buf, seq, SEQ_LEN);
+            ok = q_insert_tail(q, buf);
+        } else {
+            ok = q_insert_tail(q, seq);
+        }
+    }
+    res->insert = (now_ns() - start) / 1e9;
+
+    /* Move the second half to a queue of its own and back */
+    start = now_ns();
+    if (ok) {
+        queue_t *half = q_split(q, n / 2);
+        ok = half && q_splice_tail(q, half);
+        q_free(half);
+    }
+    res->splice = (now_ns() - start) / 1e9;
+
+    start = now_ns();
+    for (long i = 0; ok && i < n; i++) {
+        char out[READ_LEN], seq[SEQ_LEN + 1];
+        snprintf(seq, sizeof(seq), "%016lx", i);
+        ok = q_remove_head(q, out, sizeof(out)) &&
+             !strncmp(out, seq, SEQ_LEN) &&
+             strlen(out) == (i % 100 < pct ? READ_LEN - 1 : SEQ_LEN);
+    }
+    res->remove = (now_ns() - start) / 1e9;
+    ok = ok && q_size(q) == 0;
+
+    q_free(q);
+
+    return ok;
+}
+
+bool bench_blobs(long n,
+                 int pct,
+                 long len,
+                 blob_result_t *heap,
+                 blob_result_t *blob)
+{
+    char *buf = malloc(len + 1);
+    blobs_t *b = bl_new();
+    bool ok = buf && b && len >= READ_LEN;
+
+    if (ok) {
+        for (long i = 0; i < len; i++)
+            buf[i] = 'a' + i % 26;
+        buf[len] = '\0';
+
+        ok = mixed_workload(n, pct, buf, NULL, heap);
+    }
+    ok = ok && mixed_workload(n, pct, buf, b, blob);
+
+    bl_free(b);
+    free(buf);
+
+    return ok;
+}
@@ -0,0 +1,174 @@
+#ifndef LAB0_BENCH_H
+#define LAB0_BENCH_H
+
+/*
+ * Multi-threaded workloads for the concurrent queues, run by qtest.
+ *
+ * Every item carries its sequence number and the time it was produced, so
+ * that a workload can check each one arrived exactly once and measure how
+ * long the hand-off took.  Worker threads block the signals qtest uses for
+ * its time limit, which must be caught by the main thread.
+ */
+
+#include <stdbool.h>
+
+/* Outcome of a cache workload */
+typedef struct {
+    long gets;      /* Lookups made */
+    long hits;      /* Lookups that found their key */
+    long evictions; /* Entries pushed out by insertions after misses */
+    double seconds; /* Wall-clock time of the lookups and insertions */
+} cache_result_t;
+
+/* Time spent in each phase of a single-threaded queue workload */
+typedef struct {
+    double insert; /* Seconds to insert every value */
+    double reverse;
+    double sort;
+    double remove; /* Seconds to remove and read back every value */
+} phase_result_t;
+
+/* Time spent in each phase of a workload mixing small and large values */
+typedef struct {
+    double insert; /* Seconds to insert every value */
+    double splice; /* Seconds to split off half the queue and splice it back */
+    double remove; /* Seconds to remove every value, reading its start */
+} blob_result_t;
+
+typedef struct {
+    bool ok;            /* Every item arrived exactly once */
+    long items;         /* Items transferred */
+    double seconds;     /* Wall-clock time of the whole transfer */
+    double avg_latency; /* Mean time from production to consumption, in us */
+    double max_latency; /* Worst such time, in us */
+} bench_result_t;
+
+/*
+ * Move n items through a blocking queue from producers to consumers threads,
+ * producers pushing batch items at a time.  A positive capacity bounds the
+ * queue to that many items, producers waiting for room.
+ * Return false if could not start the threads.
+ */
+bool bench_bqueue(int producers,
+                  int consumers,
+                  long n,
+                  int batch,
+                  int capacity,
+                  bench_result_t *res);
+
+/*
+ * Have threads each insert then remove n / threads items, first through the
+ * lock-free queue, then through the blocking queue as a mutex baseline.
+ * Return false if could not start the threads.
+ */
+bool bench_lfqueue(int threads,
+                   long n,
+                   bench_result_t *lockfree,
+                   bench_result_t *locked);
+
+/*
+ * Move n items from one producer thread to one consumer thread, pinned to
+ * separate CPUs if possible, through a ring of the given capacity.  Items
+ * move batch at a time by pointer, or one at a time as copied strings if
+ * copy is set.
+ * Return false if could not start the threads.
+ */
+bool bench_spsc(long n, int capacity, int batch, bool copy, bench_result_t *res);
+
+/*
+ * Move n items from producers to consumers threads, which poll rather than
+ * sleep, first through the two-lock queue, then through the single-lock
+ * blocking queue.
+ * Return false if could not start the threads.
+ */
+bool bench_tlqueue(int producers,
+                   int consumers,
+                   long n,
+                   bench_result_t *two_lock,
+                   bench_result_t *one_lock);
+
+/*
+ * Sort n shuffled strings by parallel merge sort on a pool of threads
+ * workers, which steal halves of each other's ranges.  executed and stolen
+ * receive the number of tasks each worker ran and took from others.
+ * Return false if could not allocate space or start the threads.
+ */
+bool bench_wssort(int threads,
+                  long n,
+                  bench_result_t *res,
+                  long *executed,
+                  long *stolen);
+
+/*
+ * Have threads each insert then remove n / threads items, first through a
+ * relaxed queue of the given number of shards, then through the blocking
+ * queue as a single-lock baseline.  In between, fill the relaxed queue
+ * with n items in order and let every thread drain it: mean_rank and
+ * max_rank receive how many older items were still present, on average
+ * and at worst, when an item was removed.
+ * Return false if could not allocate space or start the threads.
+ */
+bool bench_mqueue(int threads,
+                  int shards,
+                  long n,
+                  bench_result_t *sharded,
+                  bench_result_t *locked,
+                  double *mean_rank,
+                  long *max_rank);
+
+/*
+ * Create n queues one after the other, insert three strings into each and
+ * free it, once with strings short enough to be stored inside the queue and
+ * once with strings that spill to the heap.  Single-threaded.
+ * inline_ns and spilled_ns receive the mean time of a cycle.
+ * Return false if could not allocate space.
+ */
+bool bench_small_queues(long n, double *inline_ns, double *spilled_ns);
+
+/*
+ * Look up n keys drawn from keys distinct ones with a Zipf distribution of
+ * exponent skew in an LRU cache of capacity entries, inserting every key
+ * that misses.  Single-threaded.
+ * Return false if could not allocate space.
+ */
+bool bench_lru(long n,
+               int keys,
+               int capacity,
+               double skew,
+               cache_result_t *res);
+
+
+/*
+ * Insert n pseudo-random 64-bit values alternately at the head and at the
+ * tail, reverse, sort and remove them, once through a typed queue of
+ * uint64_t and once through a string queue holding them zero-padded in
+ * decimal, so that both sort them alike.  Single-threaded.
+ * Return false if could not allocate space or the queues disagree.
+ */
+bool bench_typed_queue(long n, phase_result_t *typed, phase_result_t *str);
+
+/*
+ * Sort n random words of mixed case in the collation order of the current
+ * locale, once by collation keys (Q_LOCALE) and once by calling strcoll in
+ * every comparison (Q_COLLATE).  keyed and naive receive the seconds each
+ * sort took.  Single-threaded.
+ * Return false if could not allocate space or the orders differ.
+ */
+bool bench_locale_sort(long n, double *keyed, double *naive);
+
+/*
+ * Insert n values at the tail, pct percent of them len bytes long and the
+ * others short, split off half the queue and splice it back, then remove
+ * them all reading up to 1 KiB of each.  The queue stores the values on the
+ * heap first, then the values of at least 1 KiB in a blob region.
+ * Single-threaded.
+ * Return false if could not allocate space, len is shorter than 1 KiB or
+ * the values come back wrong.
+ */
+bool bench_blobs(long n,
+                 int pct,
+                 long len,
+                 blob_result_t *heap,
+                 blob_result_t *blob);
+
+#endif /* LAB0_BENCH_H */
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "blob.h"
+#include "harness.h"
+
+/* Slots this large hand their pages back to the system once freed */
+#define BLOB_TRIM_SHIFT 20
+
+/* Size of a page of the host, looked up by the first bl_new */
+static size_t page_size = 0;
+
+/******** Utility Zone ********/
+
+static inline size_t class_size(size_t cls)
+{
+    return (size_t) 1 << (BLOB_MIN_SHIFT + cls);
+}
+
+/* Smallest class whose slots fit a header and size bytes */
+static inline size_t class_of(size_t size)
+{
+    size_t cls = 0;
+    while (cls < BLOB_CLASSES && class_size(cls) - sizeof(blob_t) < size)
+        cls++;
+    return cls;
+}
+
+/******** End of Utility Zone ********/
+
+blobs_t *bl_new()
+{
+    if (!page_size)
+        page_size = sysconf(_SC_PAGESIZE);
+
+    blobs_t *b = malloc(sizeof(blobs_t));
+    if (!b)
+        return NULL;
+
+    b->base = mmap(NULL, BLOB_RESERVE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (b->base == MAP_FAILED) {
+        free(b);
+        return NULL;
+    }
+    b->reserved = BLOB_RESERVE;
+    b->top = 0;
+    b->count = 0;
+    b->bytes = 0;
+    b->slotted = 0;
+    for (int c = 0; c < BLOB_CLASSES; c++)
+        b->avail[c] = NULL;
+
+    return b;
+}
+
+void bl_free(blobs_t *b)
+{
+    if (!b)
+        return;
+
+    munmap(b->base, b->reserved);
+    free(b);
+}
+
+char *bl_store(blobs_t *b, const char *s, size_t len)
+{
+    size_t cls = class_of(len + 1);
+    if (cls == BLOB_CLASSES)
+        return NULL;
+
+    size_t size = class_size(cls);
+    blob_t *slot = b->avail[cls];
+    if (slot) {
+        b->avail[cls] = slot->next;
+    } else {
+        if (b->reserved - b->top < size)
+            return NULL;
+        slot = (blob_t *) (b->base + b->top);
+        b->top += size;
+    }
+
+    slot->len = len;
+    slot->cls = cls;
+    char *v = (char *) (slot + 1);
+    memcpy(v, s, len);
+    v[len] = '\0';
+
+    b->count++;
+    b->bytes += len + 1;
+    b->slotted += size;
+
+    return v;
+}
+
+void bl_release(blobs_t *b, char *v)
+{
+    blob_t *slot = (blob_t *) v - 1;
+    size_t cls = slot->cls, size = class_size(cls);
+
+    b->count--;
+    b->bytes -= slot->len + 1;
+    b->slotted -= size;
+
+    /*
+     * Only the page holding the header is still needed.  Slots are only
+     * aligned to the smallest class, which may be less than a page.
+     */
+    if (cls >= BLOB_TRIM_SHIFT - BLOB_MIN_SHIFT) {
+        uintptr_t mask = page_size - 1;
+        uintptr_t start = ((uintptr_t) (slot + 1) + mask) & ~mask;
+        uintptr_t end = ((uintptr_t) slot + size) & ~mask;
+        if (end > start)
+            madvise((void *) start, end - start, MADV_DONTNEED);
+    }
+
+    slot->next = b->avail[cls];
+    b->avail[cls] = slot;
+}
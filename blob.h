@@ -0,0 +1,77 @@
+#ifndef LAB0_BLOB_H
+#define LAB0_BLOB_H
+
+/*
+ * Region storing large string values outside the heap.
+ *
+ * The region reserves one range of address space with mmap up front and
+ * carves it into slots of 4 KiB times a power of two, keeping a free list per
+ * slot size.  Each slot starts with a header recording the length of its
+ * string, so a stored value never needs measuring, and whether a pointer
+ * belongs to the region is a range check.  The pages of a large freed slot
+ * go back to the system, so a burst of large values leaves no fragmented
+ * heap behind.  Queues sharing a region can move elements between them
+ * without copying their values.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Smallest slot, header included, is 1 << BLOB_MIN_SHIFT bytes */
+#define BLOB_MIN_SHIFT 12
+#define BLOB_CLASSES 24
+
+/* Address space reserved; pages only cost memory once written */
+#define BLOB_RESERVE ((size_t) 1 << 36)
+
+typedef struct blob {
+    union {
+        size_t len;        /* Length of the string, while stored */
+        struct blob *next; /* Next free slot of the class, while free */
+    };
+    size_t cls; /* Slot holds 1 << (BLOB_MIN_SHIFT + cls) bytes */
+} blob_t;
+
+typedef struct blobs {
+    char *base;      /* Start of the reserved range */
+    size_t reserved; /* Its length */
+    size_t top;      /* Offset of the first slot never handed out */
+    size_t count;    /* Values stored */
+    size_t bytes;    /* Bytes of those, terminators included */
+    size_t slotted;  /* Bytes of the slots holding them */
+    blob_t *avail[BLOB_CLASSES]; /* Free slots of each class */
+} blobs_t;
+
+/*
+ * Create an empty region.
+ * Return NULL if could not allocate space or reserve the address range.
+ */
+blobs_t *bl_new();
+
+/* Unmap the region.  No queue may hold any of its values any longer */
+void bl_free(blobs_t *b);
+
+/*
+ * Store a copy of s, of length len, and return it.
+ * Return NULL if the region is out of room.
+ */
+char *bl_store(blobs_t *b, const char *s, size_t len);
+
+/* Free the value v, stored by bl_store */
+void bl_release(blobs_t *b, char *v);
+
+/* Whether v was stored in region b, which may be NULL */
+static inline bool bl_owns(blobs_t *b, const char *v)
+{
+    uintptr_t p = (uintptr_t) v, first = b ? (uintptr_t) b->base : 0;
+    return b && p >= first && p < first + b->top;
+}
+
+/* Length of the value v, stored by bl_store */
+static inline size_t bl_length(const char *v)
+{
+    return ((const blob_t *) v - 1)->len;
+}
+
+#endif /* LAB0_BLOB_H */
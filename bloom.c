@@ -0,0 +1,145 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom.h"
+#include "harness.h"
+#include "hash.h"
+
+/* Smallest filter, in values */
+#define BF_MIN_CAPACITY 64
+
+/* Most counters set by one value */
+#define BF_MAX_K 16
+
+/******** Utility Zone ********/
+
+/*
+ * Fill pos with the k counters of s.  The two halves of a 64-bit hash
+ * combine into g_i = h1 + i * h2, which is as good as k independent hashes.
+ */
+static void positions(bloom_t *bf, const char *s, size_t *pos)
+{
+    uint64_t h = hash_str64(s);
+    /* FNV leaves the last characters poorly mixed, so finish the job */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    uint32_t h1 = h;
+    uint32_t h2 = (h >> 32) | 1;
+    for (int i = 0; i < bf->k; i++) {
+        /* Map onto [0, m) with a multiply instead of a division */
+        uint32_t g = h1 + i * h2;
+        pos[i] = ((uint64_t) g * bf->m) >> 32;
+    }
+}
+
+static inline int get_counter(bloom_t *bf, size_t i)
+{
+    return (bf->counters[i / 2] >> (i % 2 * 4)) & 0xf;
+}
+
+static inline void set_counter(bloom_t *bf, size_t i, int c)
+{
+    int shift = i % 2 * 4;
+    bf->counters[i / 2] = (bf->counters[i / 2] & ~(0xf << shift)) | c << shift;
+}
+
+/******** End of Utility Zone ********/
+
+bloom_t *bf_new(size_t capacity, double fp_rate)
+{
+    if (!(fp_rate > 0 && fp_rate < 1))
+        return NULL;
+
+    if (capacity < BF_MIN_CAPACITY)
+        capacity = BF_MIN_CAPACITY;
+
+    /* Optimal sizing: m = -n ln p / (ln 2)^2 and k = (m / n) ln 2 */
+    double m = ceil(-(double) capacity * log(fp_rate) / (M_LN2 * M_LN2));
+    if (m > UINT32_MAX)
+        return NULL;
+    int k = (int) round(m / capacity * M_LN2);
+    if (k < 1)
+        k = 1;
+    if (k > BF_MAX_K)
+        k = BF_MAX_K;
+
+    bloom_t *bf = malloc(sizeof(bloom_t));
+    if (!bf)
+        return NULL;
+
+    bf->m = (size_t) m;
+    bf->counters = malloc((bf->m + 1) / 2);
+    if (!bf->counters) {
+        free(bf);
+        return NULL;
+    }
+    memset(bf->counters, 0, (bf->m + 1) / 2);
+    bf->k = k;
+    bf->capacity = capacity;
+    bf->count = 0;
+    bf->fp_rate = fp_rate;
+
+    return bf;
+}
+
+void bf_free(bloom_t *bf)
+{
+    if (!bf)
+        return;
+
+    free(bf->counters);
+    free(bf);
+}
+
+void bf_add(bloom_t *bf, const char *s)
+{
+    size_t pos[BF_MAX_K];
+    positions(bf, s, pos);
+    for (int i = 0; i < bf->k; i++) {
+        int c = get_counter(bf, pos[i]);
+        if (c < BF_COUNTER_MAX)
+            set_counter(bf, pos[i], c + 1);
+    }
+    bf->count++;
+}
+
+void bf_remove(bloom_t *bf, const char *s)
+{
+    size_t pos[BF_MAX_K];
+    positions(bf, s, pos);
+    for (int i = 0; i < bf->k; i++) {
+        /* A saturated counter has lost track of its count */
+        int c = get_counter(bf, pos[i]);
+        if (c > 0 && c < BF_COUNTER_MAX)
+            set_counter(bf, pos[i], c - 1);
+    }
+    bf->count--;
+}
+
+bool bf_maybe_contains(bloom_t *bf, const char *s)
+{
+    size_t pos[BF_MAX_K];
+    positions(bf, s, pos);
+    for (int i = 0; i < bf->k; i++) {
+        if (!get_counter(bf, pos[i]))
+            return false;
+    }
+
+    return true;
+}
+
+double bf_estimate_fp(bloom_t *bf)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < bf->m; i++)
+        used += get_counter(bf, i) != 0;
+
+    return pow((double) used / bf->m, bf->k);
+}
+
+size_t bf_memory(bloom_t *bf)
+{
+    return bf ? sizeof(bloom_t) + (bf->m + 1) / 2 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef LAB0_BLOOM_H
+#define LAB0_BLOOM_H
+
+/*
+ * Counting Bloom filter summarizing the values of a queue.
+ *
+ * Every value sets k of m small counters, picked by double hashing.  A value
+ * whose counters are not all set is definitely absent, so most lookups of
+ * missing values need not touch the list at all.  Counters are 4 bits wide,
+ * two to a byte; one that saturates stays at its maximum forever, which can
+ * only cause false positives, never false negatives.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest value of a 4-bit counter, which then sticks */
+#define BF_COUNTER_MAX 15
+
+typedef struct bloom {
+    uint8_t *counters; /* Two 4-bit counters per byte */
+    size_t m;          /* Number of counters */
+    int k;             /* Number of counters per value */
+    size_t capacity;   /* Number of values the filter is sized for */
+    size_t count;      /* Number of values added and not removed */
+    double fp_rate;    /* Target false-positive rate at capacity */
+} bloom_t;
+
+/*
+ * Create a filter keeping the false-positive rate near fp_rate for up to
+ * capacity values.
+ * Return NULL if fp_rate is not in (0, 1) or could not allocate space.
+ */
+bloom_t *bf_new(size_t capacity, double fp_rate);
+
+/* Free the filter */
+void bf_free(bloom_t *bf);
+
+/* Add value s */
+void bf_add(bloom_t *bf, const char *s);
+
+/* Remove value s, which must have been added before */
+void bf_remove(bloom_t *bf, const char *s);
+
+/*
+ * Return false if s is definitely not in the filter.
+ * Return true if it may be.
+ */
+bool bf_maybe_contains(bloom_t *bf, const char *s);
+
+/* Estimate the current false-positive rate from the counters in use */
+double bf_estimate_fp(bloom_t *bf);
+
+/* Return number of bytes used by the filter */
+size_t bf_memory(bloom_t *bf);
+
+#endif /* LAB0_BLOOM_H */
@@ -0,0 +1,208 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bqueue.h"
+#include "harness.h"
+
+/* Turn a timeout from now into a deadline on the monotonic clock */
+static struct timespec deadline_after(int timeout_ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    return ts;
+}
+
+bqueue_t *bq_new()
+{
+    bqueue_t *bq = malloc(sizeof(bqueue_t));
+    if (!bq)
+        return NULL;
+
+    bq->q = q_new();
+    if (!bq->q) {
+        free(bq);
+        return NULL;
+    }
+
+    /* Deadlines must not jump with the wall clock */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&bq->nonempty, &attr);
+    pthread_cond_init(&bq->nonfull, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_init(&bq->lock, NULL);
+    bq->waiting = 0;
+    bq->blocked = 0;
+    bq->closed = false;
+
+    return bq;
+}
+
+void bq_free(bqueue_t *bq)
+{
+    if (!bq)
+        return;
+
+    q_free(bq->q);
+    pthread_cond_destroy(&bq->nonempty);
+    pthread_cond_destroy(&bq->nonfull);
+    pthread_mutex_destroy(&bq->lock);
+    free(bq);
+}
+
+/*
+ * Wait until s fits into a queue bounded with Q_BLOCK.  A string too long
+ * to fit even into an empty queue is left to be rejected.  Lock held.
+ */
+static void wait_for_room(bqueue_t *bq, char *s)
+{
+    while (bq->q->policy == Q_BLOCK && !bq->closed && q_size(bq->q) > 0 &&
+           !q_fits(bq->q, s)) {
+        /* A batch may have filled the queue before telling anyone */
+        if (bq->waiting > 0)
+            pthread_cond_broadcast(&bq->nonempty);
+        bq->blocked++;
+        pthread_cond_wait(&bq->nonfull, &bq->lock);
+        bq->blocked--;
+    }
+}
+
+bool bq_set_capacity(bqueue_t *bq,
+                     size_t limit,
+                     bool bytes,
+                     q_policy_t policy)
+{
+    if (!bq)
+        return false;
+
+    pthread_mutex_lock(&bq->lock);
+    q_set_capacity(bq->q, limit, bytes, policy);
+    pthread_mutex_unlock(&bq->lock);
+
+    /* Blocked producers may fit now, or never have to wait again */
+    pthread_cond_broadcast(&bq->nonfull);
+
+    return true;
+}
+
+bool bq_push(bqueue_t *bq, char *s)
+{
+    if (!bq)
+        return false;
+
+    pthread_mutex_lock(&bq->lock);
+    wait_for_room(bq, s);
+    bool ok = !bq->closed && q_insert_tail(bq->q, s);
+    bool wake = ok && bq->waiting > 0;
+    pthread_mutex_unlock(&bq->lock);
+
+    /* Signal outside the lock, so the woken consumer need not block on it */
+    if (wake)
+        pthread_cond_signal(&bq->nonempty);
+
+    return ok;
+}
+
+int bq_push_batch(bqueue_t *bq, char **vals, int n)
+{
+    if (!bq)
+        return 0;
+
+    int cnt = 0;
+    pthread_mutex_lock(&bq->lock);
+    while (cnt < n) {
+        wait_for_room(bq, vals[cnt]);
+        if (bq->closed || !q_insert_tail(bq->q, vals[cnt]))
+            break;
+        cnt++;
+    }
+    int waiting = bq->waiting;
+    pthread_mutex_unlock(&bq->lock);
+
+    if (cnt >= waiting) {
+        if (waiting > 0)
+            pthread_cond_broadcast(&bq->nonempty);
+    } else {
+        for (int i = 0; i < cnt; i++)
+            pthread_cond_signal(&bq->nonempty);
+    }
+
+    return cnt;
+}
+
+bq_status_t bq_pop_wait(bqueue_t *bq, char *sp, size_t bufsize, int timeout_ms)
+{
+    if (!bq)
+        return BQ_CLOSED;
+
+    struct timespec deadline;
+    if (timeout_ms >= 0)
+        deadline = deadline_after(timeout_ms);
+
+    bq_status_t status = BQ_OK;
+    pthread_mutex_lock(&bq->lock);
+    while (q_size(bq->q) == 0) {
+        if (bq->closed) {
+            status = BQ_CLOSED;
+            break;
+        }
+
+        bq->waiting++;
+        int rc = timeout_ms < 0
+                     ? pthread_cond_wait(&bq->nonempty, &bq->lock)
+                     : pthread_cond_timedwait(&bq->nonempty, &bq->lock,
+                                              &deadline);
+        bq->waiting--;
+
+        /* An element may still have slipped in right at the deadline */
+        if (rc == ETIMEDOUT && q_size(bq->q) == 0) {
+            status = bq->closed ? BQ_CLOSED : BQ_TIMEOUT;
+            break;
+        }
+    }
+    if (status == BQ_OK)
+        q_remove_head(bq->q, sp, bufsize);
+    bool room = status == BQ_OK && bq->blocked > 0;
+    pthread_mutex_unlock(&bq->lock);
+
+    /* Freed bytes may let several short strings in */
+    if (room)
+        pthread_cond_broadcast(&bq->nonfull);
+
+    return status;
+}
+
+void bq_close(bqueue_t *bq)
+{
+    if (!bq)
+        return;
+
+    pthread_mutex_lock(&bq->lock);
+    bq->closed = true;
+    pthread_mutex_unlock(&bq->lock);
+
+    pthread_cond_broadcast(&bq->nonempty);
+    pthread_cond_broadcast(&bq->nonfull);
+}
+
+size_t bq_size(bqueue_t *bq)
+{
+    if (!bq)
+        return 0;
+
+    pthread_mutex_lock(&bq->lock);
+    size_t size = q_size(bq->q);
+    pthread_mutex_unlock(&bq->lock);
+
+    return size;
+}
@@ -0,0 +1,102 @@
+#ifndef LAB0_BQUEUE_H
+#define LAB0_BQUEUE_H
+
+/*
+ * Blocking queue: a queue_t shared by any number of producer and consumer
+ * threads.
+ *
+ * One mutex guards the queue.  Consumers that find it empty sleep on a
+ * condition variable instead of polling, and producers only signal when
+ * someone is actually asleep, so an uncontended hand-off costs no system
+ * call.  A batch insertion wakes at most as many consumers as it brings
+ * elements, all in one go.  Closing the queue refuses further insertions
+ * and wakes every consumer; they drain what is left, then learn that the
+ * queue is closed.
+ *
+ * Bounded with the Q_BLOCK policy, the queue makes producers wait for room
+ * instead of failing, which pushes back on them when consumers fall behind.
+ * The other overflow policies act as they do on queue_t.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "queue.h"
+
+/* Outcome of bq_pop_wait */
+typedef enum { BQ_OK, BQ_TIMEOUT, BQ_CLOSED } bq_status_t;
+
+typedef struct {
+    queue_t *q;
+    pthread_mutex_t lock;
+    pthread_cond_t nonempty;
+    pthread_cond_t nonfull;
+    int waiting; /* Number of consumers asleep on nonempty */
+    int blocked; /* Number of producers asleep on nonfull */
+    bool closed;
+} bqueue_t;
+
+/*
+ * Create empty blocking queue.
+ * Return NULL if could not allocate space.
+ */
+bqueue_t *bq_new();
+
+/*
+ * Free ALL storage used by blocking queue.  No thread may be using it.
+ * No effect if bq is NULL
+ */
+void bq_free(bqueue_t *bq);
+
+/*
+ * Bound queue as q_set_capacity does.
+ * Return false if bq is NULL.
+ */
+bool bq_set_capacity(bqueue_t *bq,
+                     size_t limit,
+                     bool bytes,
+                     q_policy_t policy);
+
+/*
+ * Attempt to insert element at tail of queue, waking a sleeping consumer.
+ * With the Q_BLOCK policy, wait for room first.
+ * Return true if successful.
+ * Return false if bq is NULL, closed, could not allocate space, or refused
+ * the element for lack of room.
+ */
+bool bq_push(bqueue_t *bq, char *s);
+
+/*
+ * Insert the n strings of vals at tail of queue under a single lock, then
+ * wake up to n sleeping consumers at once.  With the Q_BLOCK policy the
+ * lock is let go while waiting for room.
+ * Return number of strings inserted, which is less than n if bq is closed
+ * or could not allocate space.
+ */
+int bq_push_batch(bqueue_t *bq, char **vals, int n);
+
+/*
+ * Remove element from head of queue, waiting up to timeout_ms milliseconds
+ * for one to arrive.  A negative timeout waits for ever.
+ * Return BQ_OK if an element was removed.  If sp is non-NULL its string is
+ * copied to *sp (up to a maximum of bufsize-1 characters, plus a null
+ * terminator.)
+ * Return BQ_TIMEOUT if the time ran out first.
+ * Return BQ_CLOSED if bq is NULL, or closed and drained.
+ */
+bq_status_t bq_pop_wait(bqueue_t *bq, char *sp, size_t bufsize, int timeout_ms);
+
+/*
+ * Close queue: later insertions fail, and consumers return BQ_CLOSED once
+ * nothing is left.  No effect if bq is NULL
+ */
+void bq_close(bqueue_t *bq);
+
+/*
+ * Return number of elements in queue.
+ * Return 0 if bq is NULL or empty
+ */
+size_t bq_size(bqueue_t *bq);
+
+#endif /* LAB0_BQUEUE_H */
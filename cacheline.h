@@ -0,0 +1,19 @@
+#ifndef LAB0_CACHELINE_H
+#define LAB0_CACHELINE_H
+
+/*
+ * Size of a cache line.  Fields written by different threads are kept at
+ * least this far apart, so that they do not bounce one line between cores.
+ */
+#define CACHE_LINE 64
+
+/* Padding filling the rest of the last line after fields of the given size */
+#define CACHE_PAD(name, size) char name[CACHE_LINE - (size) % CACHE_LINE]
+
+/*
+ * A whole line of padding.  The harness malloc only aligns to 16 bytes, so
+ * fields a whole line apart never share one, wherever the structure starts.
+ */
+#define CACHE_GAP(name) char name[CACHE_LINE]
+
+#endif /* LAB0_CACHELINE_H */
@@ -3,6 +3,7 @@
 #include "console.h"
 
 #include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -328,15 +329,26 @@ static bool do_comment_cmd(int argc, char *argv[])
 /* Extract integer from text and store at loc */
 bool get_int(char *vname, int *loc)
 {
-    char *end = NULL;
-    long int v = strtol(vname, &end, 0);
-    if (v == LONG_MIN || *end != '\0')
+    long v;
+    if (!get_long(vname, &v) || v < INT_MIN || v > INT_MAX)
         return false;
 
     *loc = (int) v;
     return true;
 }
 
+bool get_long(char *vname, long *loc)
+{
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(vname, &end, 0);
+    if (errno == ERANGE || end == vname || *end != '\0')
+        return false;
+
+    *loc = v;
+    return true;
+}
+
 static bool do_option_cmd(int argc, char *argv[])
 {
     if (argc == 1) {
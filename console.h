@@ -53,6 +53,9 @@ void add_param(char *name,
 /* Extract integer from text and store at loc */
 bool get_int(char *vname, int *loc);
 
+/* Same for a long, used for counts that may exceed INT_MAX */
+bool get_long(char *vname, long *loc);
+
 /* Add function to be executed as part of program exit */
 void add_quit_helper(cmd_function qf);
 
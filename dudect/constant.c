@@ -7,6 +7,7 @@
 #include <string.h>
 #include <unistd.h>
 #include "cpucycles.h"
+#include "pqueue.h"
 #include "queue.h"
 #include "random.h"
 
@@ -22,7 +23,9 @@ const int drop_size = 20;
 static queue_t *q = NULL;
 static char random_string[NR_MEASURE][8];
 static int random_string_iter = 0;
-enum { test_insert_tail, test_size };
+
+/* Priority queues of 2^LOG_SMALL_SHIFT and 2^LOG_LARGE_SHIFT elements */
+static pqueue_t *pq[2] = {NULL, NULL};
 
 /* Implement the necessary queue interface to simulation */
 void init_dut(void)
@@ -30,6 +33,15 @@ void init_dut(void)
     q = NULL;
 }
 
+/* Release the priority queues kept across measurements */
+void release_dut(void)
+{
+    for (int i = 0; i < 2; i++) {
+        pq_free(pq[i]);
+        pq[i] = NULL;
+    }
+}
+
 char *get_random_string(void)
 {
     random_string_iter = (random_string_iter + 1) % NR_MEASURE;
@@ -52,11 +64,57 @@ void prepare_inputs(uint8_t *input_data, uint8_t *classes)
     }
 }
 
+/*
+ * Building a heap of 2^LOG_LARGE_SHIFT elements per measurement would take
+ * far longer than the measurement itself, so both heaps are filled once and
+ * kept at their size by undoing every measured operation.
+ */
+static void prepare_pqueues(void)
+{
+    static const int shift[2] = {LOG_SMALL_SHIFT, LOG_LARGE_SHIFT};
+    for (int i = 0; i < 2; i++) {
+        if (pq[i])
+            continue;
+        pq[i] = pq_new();
+        for (int n = 0; n < (1 << shift[i]); n++)
+            pq_insert(pq[i], get_random_string());
+    }
+}
+
+static void measure_pqueue(int64_t *before_ticks,
+                           int64_t *after_ticks,
+                           uint8_t *classes,
+                           int mode)
+{
+    prepare_pqueues();
+    for (size_t i = drop_size; i < number_measurements - drop_size; i++) {
+        pqueue_t *p = pq[classes[i]];
+        char *s = get_random_string();
+        if (mode == test_pq_insert) {
+            before_ticks[i] = cpucycles();
+            pq_insert(p, s);
+            after_ticks[i] = cpucycles();
+            pq_remove_min(p, NULL, 0);
+        } else {
+            before_ticks[i] = cpucycles();
+            pq_remove_min(p, NULL, 0);
+            after_ticks[i] = cpucycles();
+            pq_insert(p, s);
+        }
+    }
+}
+
 void measure(int64_t *before_ticks,
              int64_t *after_ticks,
              uint8_t *input_data,
+             uint8_t *classes,
              int mode)
 {
+    if (mode == test_pq_insert || mode == test_pq_remove_min) {
+        measure_pqueue(before_ticks, after_ticks, classes, mode);
+        return;
+    }
+
     assert(mode == test_insert_tail || mode == test_size);
     if (mode == test_insert_tail) {
         for (size_t i = drop_size; i < number_measurements - drop_size; i++) {
@@ -2,6 +2,20 @@
 #define DUDECT_CONSTANT_H
 
 #include <stdint.h>
+
+/* Operations that can be measured */
+enum { test_insert_tail, test_size, test_pq_insert, test_pq_remove_min };
+
+/*
+ * Priority queue sizes compared by the logarithmic-time tests.  If an
+ * operation is O(log n), the big heap costs at most LOG_SLACK times the
+ * ratio of the logarithms more than the small one; a linear operation is
+ * off by far more than that.
+ */
+#define LOG_SMALL_SHIFT 8
+#define LOG_LARGE_SHIFT 14
+#define LOG_SLACK 2
+
 #define dut_new() ((void) (q = q_new()))
 
 #define dut_size(n)                                \
@@ -27,10 +41,12 @@
 #define dut_free() ((void) (q_free(q)))
 
 void init_dut();
+void release_dut();
 void prepare_inputs(uint8_t *input_data, uint8_t *classes);
 void measure(int64_t *before_ticks,
              int64_t *after_ticks,
              uint8_t *input_data,
+             uint8_t *classes,
              int mode);
 
 #endif
@@ -8,4 +8,8 @@
 bool is_insert_tail_const(void);
 bool is_size_const(void);
 
+/* Interface to test if function is logarithmic */
+bool is_pq_insert_log(void);
+bool is_pq_remove_min_log(void);
+
 #endif
@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "frozen.h"
+#include "harness.h"
+
+/******** Utility Zone ********/
+
+static inline size_t varint_len(size_t v)
+{
+    size_t n = 1;
+    for (; v >= 0x80; v >>= 7)
+        n++;
+    return n;
+}
+
+/* Store v 7 bits at a time, low bits first, and return the next byte */
+static unsigned char *put_varint(unsigned char *p, size_t v)
+{
+    for (; v >= 0x80; v >>= 7)
+        *p++ = (v & 0x7f) | 0x80;
+    *p++ = v;
+    return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p, size_t *v)
+{
+    size_t x = 0;
+    int shift = 0;
+    for (; *p & 0x80; shift += 7)
+        x |= (size_t) (*p++ & 0x7f) << shift;
+    *v = x | (size_t) *p++ << shift;
+    return p;
+}
+
+/* Length of the prefix a shares with b, of length len */
+static inline size_t shared_prefix(const char *a, const char *b, size_t len)
+{
+    size_t n = 0;
+    while (n < len && a[n] == b[n])
+        n++;
+    return n;
+}
+
+/*
+ * Encode the count strings starting at e into a block of their own.
+ * Return NULL if could not allocate space.
+ */
+static fz_block_t *encode(list_ele_t *e, size_t count)
+{
+    /* Size the block first, so that it takes a single allocation */
+    size_t used = 0;
+    const char *prev = NULL;
+    list_ele_t *x = e;
+    for (size_t i = 0; i < count; i++, x = x->next) {
+        size_t len = strlen(x->value);
+        size_t shared = prev ? shared_prefix(prev, x->value, len) : 0;
+        used += varint_len(shared) + varint_len(len - shared) + len - shared;
+        prev = x->value;
+    }
+
+    fz_block_t *b = malloc(sizeof(fz_block_t) + used);
+    if (!b)
+        return NULL;
+    b->count = count;
+    b->used = used;
+
+    unsigned char *p = b->data;
+    prev = NULL;
+    for (size_t i = 0; i < count; i++, e = e->next) {
+        size_t len = strlen(e->value);
+        size_t shared = prev ? shared_prefix(prev, e->value, len) : 0;
+        p = put_varint(p, shared);
+        p = put_varint(p, len - shared);
+        memcpy(p, e->value + shared, len - shared);
+        p += len - shared;
+        prev = e->value;
+    }
+
+    return b;
+}
+
+/*
+ * Decode the string at offset of b over buf, which holds the string before
+ * it, and move offset past it.  Return its length.
+ */
+static size_t decode(fz_block_t *b, size_t *offset, char *buf)
+{
+    size_t shared, rest;
+    const unsigned char *p = get_varint(b->data + *offset, &shared);
+    p = get_varint(p, &rest);
+    memcpy(buf + shared, p, rest);
+    buf[shared + rest] = '\0';
+    *offset = p + rest - b->data;
+
+    return shared + rest;
+}
+
+/******** End of Utility Zone ********/
+
+frozen_t *fz_freeze(queue_t *q, size_t block_size)
+{
+    if (!q || block_size == 0)
+        return NULL;
+
+    frozen_t *fz = malloc(sizeof(frozen_t));
+    if (!fz)
+        return NULL;
+
+    fz->nblocks = (q->size + block_size - 1) / block_size;
+    fz->block_size = block_size;
+    fz->size = q->size;
+    fz->bytes = 0;
+    fz->encoded = 0;
+    fz->max_len = 0;
+    fz->first = 0;
+    fz->offset = 0;
+    fz->taken = 0;
+    fz->last_len = 0;
+    for (list_ele_t *e = q->head; e; e = e->next) {
+        size_t len = strlen(e->value);
+        fz->bytes += len + 1;
+        if (len > fz->max_len)
+            fz->max_len = len;
+    }
+
+    fz->blocks = malloc((fz->nblocks + 1) * sizeof(fz_block_t *));
+    fz->last = malloc(fz->max_len + 1);
+    if (!fz->blocks || !fz->last) {
+        free(fz->blocks);
+        free(fz->last);
+        free(fz);
+        return NULL;
+    }
+    fz->last[0] = '\0';
+    for (size_t i = 0; i < fz->nblocks; i++)
+        fz->blocks[i] = NULL;
+
+    list_ele_t *e = q->head;
+    for (size_t i = 0; i < fz->nblocks; i++) {
+        size_t count = q->size - i * block_size;
+        if (count > block_size)
+            count = block_size;
+
+        fz->blocks[i] = encode(e, count);
+        if (!fz->blocks[i]) {
+            fz_free(fz);
+            return NULL;
+        }
+        fz->encoded += fz->blocks[i]->used;
+        while (count--)
+            e = e->next;
+    }
+
+    return fz;
+}
+
+queue_t *fz_thaw(frozen_t *fz)
+{
+    if (!fz)
+        return NULL;
+
+    fz_iter_t it;
+    queue_t *q = q_new();
+    if (!q || !fz_iter_init(&it, fz)) {
+        q_free(q);
+        return NULL;
+    }
+
+    bool ok = true;
+    const char *s;
+    while (ok && (s = fz_iter_next(&it)))
+        ok = q_insert_tail(q, (char *) s);
+    fz_iter_done(&it);
+
+    if (!ok) {
+        q_free(q);
+        return NULL;
+    }
+
+    return q;
+}
+
+void fz_free(frozen_t *fz)
+{
+    if (!fz)
+        return;
+
+    for (size_t i = fz->first; i < fz->nblocks; i++)
+        free(fz->blocks[i]);
+    free(fz->blocks);
+    free(fz->last);
+    free(fz);
+}
+
+bool fz_remove_head(frozen_t *fz, char *sp, size_t bufsize)
+{
+    if (!fz || fz->size == 0)
+        return false;
+
+    fz_block_t *b = fz->blocks[fz->first];
+    fz->last_len = decode(b, &fz->offset, fz->last);
+    if (sp) {
+        size_t len = fz->last_len < bufsize - 1 ? fz->last_len : bufsize - 1;
+        memcpy(sp, fz->last, len);
+        sp[len] = '\0';
+    }
+    fz->size--;
+    fz->bytes -= fz->last_len + 1;
+
+    /* A block read to the end is of no further use */
+    if (++fz->taken == b->count) {
+        fz->encoded -= b->used;
+        free(b);
+        fz->blocks[fz->first++] = NULL;
+        fz->offset = 0;
+        fz->taken = 0;
+    }
+
+    return true;
+}
+
+size_t fz_memory(frozen_t *fz)
+{
+    if (!fz)
+        return 0;
+
+    return sizeof(frozen_t) + (fz->nblocks + 1) * sizeof(fz_block_t *) +
+           fz->max_len + 1 + (fz->nblocks - fz->first) * sizeof(fz_block_t) +
+           fz->encoded;
+}
+
+bool fz_iter_init(fz_iter_t *it, frozen_t *fz)
+{
+    it->buf = malloc(fz->max_len + 1);
+    if (!it->buf)
+        return false;
+
+    /* The head may share a prefix with the string removed before it */
+    it->fz = fz;
+    it->block = fz->first;
+    it->offset = fz->offset;
+    it->taken = fz->taken;
+    it->len = fz->last_len;
+    memcpy(it->buf, fz->last, fz->last_len + 1);
+
+    return true;
+}
+
+const char *fz_iter_next(fz_iter_t *it)
+{
+    if (it->block >= it->fz->nblocks)
+        return NULL;
+
+    fz_block_t *b = it->fz->blocks[it->block];
+    it->len = decode(b, &it->offset, it->buf);
+    if (++it->taken == b->count) {
+        it->block++;
+        it->offset = 0;
+        it->taken = 0;
+    }
+
+    return it->buf;
+}
+
+void fz_iter_done(fz_iter_t *it)
+{
+    free(it->buf);
+    it->buf = NULL;
+}
@@ -0,0 +1,100 @@
+#ifndef LAB0_FROZEN_H
+#define LAB0_FROZEN_H
+
+/*
+ * Frozen queue: a read-mostly copy of a queue's strings, front coded.
+ *
+ * The strings are packed into blocks of a fixed number of them.  The first
+ * string of a block, its restart point, is stored whole; each later one
+ * only as the length of the prefix it shares with the one before, and the
+ * rest of it.  Both lengths are varints, and no terminators are stored.
+ * Neighbours in a sorted queue share long prefixes, so this takes a
+ * fraction of the list layout, with no element or allocation per string.
+ *
+ * Strings are read back in order, by an iterator or by removing them from
+ * the head; a block is freed as soon as its last string is removed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "queue.h"
+
+/* Strings per block if the caller has no preference */
+#define FZ_BLOCK 16
+
+typedef struct {
+    size_t count; /* Strings encoded in the block */
+    size_t used;  /* Bytes of data */
+    unsigned char data[];
+} fz_block_t;
+
+typedef struct frozen {
+    fz_block_t **blocks;
+    size_t nblocks;
+    size_t block_size; /* Strings per block, but maybe the last */
+    size_t size;       /* Strings left */
+    size_t bytes;      /* Their length, terminators included */
+    size_t encoded;    /* Bytes of data in the blocks left */
+    size_t max_len;    /* Length of the longest string */
+    /* Where the head is */
+    size_t first;  /* Block holding it */
+    size_t offset; /* Start of its encoding in that block */
+    size_t taken;  /* Strings removed from that block already */
+    char *last;    /* String removed last, which it may share a prefix with */
+    size_t last_len;
+} frozen_t;
+
+/* Sequential reader of a frozen queue, from its head on */
+typedef struct {
+    frozen_t *fz;
+    size_t block;
+    size_t offset;
+    size_t taken;
+    char *buf; /* String read last */
+    size_t len;
+} fz_iter_t;
+
+/*
+ * Encode the strings of q, in their order, block_size strings per block.
+ * q itself is left as it is.
+ * Return NULL if q is NULL, block_size is 0 or could not allocate space.
+ */
+frozen_t *fz_freeze(queue_t *q, size_t block_size);
+
+/*
+ * Create a queue holding the strings left in fz, in order.  fz itself is
+ * left as it is.
+ * Return NULL if fz is NULL or could not allocate space.
+ */
+queue_t *fz_thaw(frozen_t *fz);
+
+/* Free all storage used by fz.  No effect if fz is NULL */
+void fz_free(frozen_t *fz);
+
+/*
+ * Attempt to remove the string at head of fz, with the contract of
+ * q_remove_head.
+ * Return false if fz is NULL or empty.
+ */
+bool fz_remove_head(frozen_t *fz, char *sp, size_t bufsize);
+
+/* Return number of bytes used by fz, blocks included */
+size_t fz_memory(frozen_t *fz);
+
+/*
+ * Start reading fz from its head.  fz must not change until the reading
+ * is done.
+ * Return false if could not allocate space.
+ */
+bool fz_iter_init(fz_iter_t *it, frozen_t *fz);
+
+/*
+ * Return the next string, valid until the next call, or NULL past the last.
+ */
+const char *fz_iter_next(fz_iter_t *it);
+
+/* Free the storage used by the reading */
+void fz_iter_done(fz_iter_t *it);
+
+#endif /* LAB0_FROZEN_H */
@@ -1,5 +1,6 @@
 /* Test support code */
 
+#include <pthread.h>
 #include <setjmp.h>
 #include <signal.h>
 #include <stdio.h>
@@ -44,6 +45,9 @@ typedef struct BELE {
 static block_ele_t *allocated = NULL;
 static size_t allocated_count = 0;
 
+/* The concurrent queues allocate from several threads at once */
+static pthread_mutex_t allocated_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Percent probability of malloc failure */
 int fail_probability = 0;
 
@@ -60,11 +64,35 @@ static int time_limit = 1;
 static jmp_buf env;
 static volatile sig_atomic_t jmp_ready = false;
 static bool time_limited = false;
+static __thread volatile sig_atomic_t holding_lock = false;
+static __thread volatile sig_atomic_t exception_deferred = false;
 
 /*
  * Internal functions
  */
 
+/*
+ * Take the lock on the list of allocated blocks.  An exception raised
+ * meanwhile, by the time limit alarm, is deferred until the lock is
+ * released, so that its longjmp never leaves the lock taken.  Nothing may
+ * be reported while holding it, as reporting may longjmp too.
+ */
+static void lock_allocated()
+{
+    holding_lock = true;
+    pthread_mutex_lock(&allocated_lock);
+}
+
+static void unlock_allocated()
+{
+    pthread_mutex_unlock(&allocated_lock);
+    holding_lock = false;
+    if (exception_deferred) {
+        exception_deferred = false;
+        trigger_exception(error_message);
+    }
+}
+
 /* Should this allocation fail? */
 static bool fail_allocation()
 {
@@ -86,12 +114,14 @@ static block_ele_t *find_header(void *p)
     block_ele_t *b = (block_ele_t *) ((size_t) p - sizeof(block_ele_t));
     if (cautious_mode) {
         /* Make sure this is really an allocated block */
+        lock_allocated();
         block_ele_t *ab = allocated;
         bool found = false;
         while (ab && !found) {
             found = ab == b;
             ab = ab->next;
         }
+        unlock_allocated();
         if (!found) {
             report_event(MSG_ERROR,
                          "Attempted to free unallocated block.  Address = %p",
@@ -148,6 +178,7 @@ void *test_malloc(size_t size)
     *find_footer(new_block) = MAGICFOOTER;
     void *p = (void *) &new_block->payload;
     memset(p, FILLCHAR, size);
+    lock_allocated();
     // cppcheck-suppress nullPointerRedundantCheck
     new_block->next = allocated;
     // cppcheck-suppress nullPointerRedundantCheck
@@ -157,6 +188,7 @@ void *test_malloc(size_t size)
         allocated->prev = new_block;
     allocated = new_block;
     allocated_count++;
+    unlock_allocated();
 
     return p;
 }
@@ -197,6 +229,7 @@ void test_free(void *p)
     memset(p, FILLCHAR, b->payload_size);
 
     /* Unlink from list */
+    lock_allocated();
     block_ele_t *bn = b->next;
     block_ele_t *bp = b->prev;
     if (bp)
@@ -205,9 +238,10 @@ void test_free(void *p)
         allocated = bn;
     if (bn)
         bn->prev = bp;
+    allocated_count--;
+    unlock_allocated();
 
     free(b);
-    allocated_count--;
 }
 
 // cppcheck-suppress unusedFunction
@@ -308,6 +342,10 @@ void trigger_exception(char *msg)
 {
     error_occurred = true;
     error_message = msg;
+    if (holding_lock) {
+        exception_deferred = true;
+        return;
+    }
     if (jmp_ready)
         siglongjmp(env, 1);
     else
@@ -0,0 +1,28 @@
+#ifndef LAB0_HASH_H
+#define LAB0_HASH_H
+
+#include <stdint.h>
+
+/* 32-bit FNV-1a hash of a NUL-terminated string */
+static inline uint32_t hash_str(const char *s)
+{
+    uint32_t h = 2166136261U;
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* 64-bit FNV-1a hash of a NUL-terminated string */
+static inline uint64_t hash_str64(const char *s)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+#endif /* LAB0_HASH_H */
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "hash.h"
+#include "hashidx.h"
+
+/* Smallest table, in slots */
+#define HI_MIN_CAPACITY 16
+
+/******** Utility Zone ********/
+
+static inline size_t slot_of(hashidx_t *hi, uint32_t hash)
+{
+    return hash & (hi->capacity - 1);
+}
+
+static hi_entry_t *create_slots(size_t capacity)
+{
+    hi_entry_t *slots = malloc(capacity * sizeof(hi_entry_t));
+    if (!slots)
+        return NULL;
+
+    memset(slots, 0, capacity * sizeof(hi_entry_t));
+
+    return slots;
+}
+
+/* Return the slot holding value s, or the empty slot where it belongs */
+static hi_entry_t *lookup(hashidx_t *hi, uint32_t hash, const char *s)
+{
+    size_t i = slot_of(hi, hash);
+    while (hi->slots[i].ele) {
+        list_ele_t *e = hi->slots[i].ele;
+        if (e->value == s ||
+            (hi->slots[i].hash == hash && !strcmp(e->value, s)))
+            break;
+        i = (i + 1) & (hi->capacity - 1);
+    }
+
+    return &hi->slots[i];
+}
+
+/* Store an entry known not to be present yet */
+static void place(hashidx_t *hi, uint32_t hash, list_ele_t *e)
+{
+    size_t i = slot_of(hi, hash);
+    while (hi->slots[i].ele)
+        i = (i + 1) & (hi->capacity - 1);
+
+    hi->slots[i].hash = hash;
+    hi->slots[i].ele = e;
+}
+
+/* Move every entry to a table of the given capacity */
+static bool rehash(hashidx_t *hi, size_t capacity)
+{
+    hi_entry_t *slots = create_slots(capacity);
+    if (!slots)
+        return false;
+
+    hi_entry_t *old = hi->slots;
+    size_t old_capacity = hi->capacity;
+    hi->slots = slots;
+    hi->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].ele)
+            place(hi, old[i].hash, old[i].ele);
+    }
+    free(old);
+
+    return true;
+}
+
+/******** End of Utility Zone ********/
+
+hashidx_t *hi_new(list_ele_t *head)
+{
+    hashidx_t *hi = malloc(sizeof(hashidx_t));
+    if (!hi)
+        return NULL;
+
+    hi->slots = create_slots(HI_MIN_CAPACITY);
+    if (!hi->slots) {
+        free(hi);
+        return NULL;
+    }
+    hi->capacity = HI_MIN_CAPACITY;
+    hi->count = 0;
+
+    /* Duplicates share a slot, so grow with the distinct values only */
+    for (list_ele_t *e = head; e; e = e->next) {
+        if (!hi_reserve(hi)) {
+            hi_free(hi);
+            return NULL;
+        }
+        hi_add(hi, e);
+    }
+
+    return hi;
+}
+
+void hi_free(hashidx_t *hi)
+{
+    if (!hi)
+        return;
+
+    free(hi->slots);
+    free(hi);
+}
+
+bool hi_reserve(hashidx_t *hi)
+{
+    if ((hi->count + 1) * 2 <= hi->capacity)
+        return true;
+
+    return rehash(hi, hi->capacity * 2);
+}
+
+void hi_add(hashidx_t *hi, list_ele_t *e)
+{
+    uint32_t hash = hash_str(e->value);
+    hi_entry_t *slot = lookup(hi, hash, e->value);
+    if (slot->ele) {
+        /* Join the ring of elements holding the same value */
+        list_ele_t *first = slot->ele;
+        e->sib_next = first->sib_next;
+        e->sib_prev = first;
+        first->sib_next->sib_prev = e;
+        first->sib_next = e;
+        return;
+    }
+
+    e->sib_next = e;
+    e->sib_prev = e;
+    slot->hash = hash;
+    slot->ele = e;
+    hi->count++;
+}
+
+void hi_remove(hashidx_t *hi, list_ele_t *e)
+{
+    hi_entry_t *slot = lookup(hi, hash_str(e->value), e->value);
+    if (!slot->ele)
+        return;
+
+    if (e->sib_next != e) {
+        e->sib_prev->sib_next = e->sib_next;
+        e->sib_next->sib_prev = e->sib_prev;
+        if (slot->ele == e)
+            slot->ele = e->sib_next;
+        return;
+    }
+
+    /*
+     * Last element of its value: shift back every following entry of the
+     * cluster whose home slot lies at or before the hole, so that no probe
+     * sequence gets broken.
+     */
+    size_t mask = hi->capacity - 1;
+    size_t i = slot - hi->slots;
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (!hi->slots[j].ele)
+            break;
+
+        size_t k = slot_of(hi, hi->slots[j].hash);
+        bool movable = i <= j ? (k <= i || k > j) : (k <= i && k > j);
+        if (movable) {
+            hi->slots[i] = hi->slots[j];
+            i = j;
+        }
+    }
+    hi->slots[i].ele = NULL;
+    hi->count--;
+}
+
+list_ele_t *hi_find(hashidx_t *hi, const char *s)
+{
+    return lookup(hi, hash_str(s), s)->ele;
+}
+
+size_t hi_memory(hashidx_t *hi)
+{
+    return hi ? sizeof(hashidx_t) + hi->capacity * sizeof(hi_entry_t) : 0;
+}
@@ -0,0 +1,62 @@
+#ifndef LAB0_HASHIDX_H
+#define LAB0_HASHIDX_H
+
+/*
+ * Hash index mapping the values of a queue to their list elements.
+ *
+ * It is an open-addressing table with linear probing and one slot per
+ * distinct value.  Elements holding the same value are chained in a ring
+ * through their sib_next/sib_prev links, so a million copies of one string
+ * still cost a single probe, and any of them can leave in O(1).  Deletion
+ * shifts the following entries back instead of leaving tombstones, which
+ * keeps probe sequences short however many removals happen.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+typedef struct {
+    uint32_t hash;   /* Cached hash of ele->value */
+    list_ele_t *ele; /* Any element of the ring, NULL for an empty slot */
+} hi_entry_t;
+
+typedef struct hashidx {
+    hi_entry_t *slots;
+    size_t capacity; /* Always a power of two */
+    size_t count;    /* Number of distinct values */
+} hashidx_t;
+
+/*
+ * Create an index holding every element of the chain starting at head.
+ * Return NULL if could not allocate space.
+ */
+hashidx_t *hi_new(list_ele_t *head);
+
+/* Free the index.  The elements are left untouched */
+void hi_free(hashidx_t *hi);
+
+/*
+ * Make sure one more value can be added without allocating.
+ * Return false if could not allocate space.
+ */
+bool hi_reserve(hashidx_t *hi);
+
+/* Add element e.  hi_reserve must have succeeded beforehand */
+void hi_add(hashidx_t *hi, list_ele_t *e);
+
+/* Remove element e, which must be in the index */
+void hi_remove(hashidx_t *hi, list_ele_t *e);
+
+/*
+ * Return an element whose value equals s.
+ * Return NULL if there is none.
+ */
+list_ele_t *hi_find(hashidx_t *hi, const char *s);
+
+/* Return number of bytes used by the index */
+size_t hi_memory(hashidx_t *hi);
+
+#endif /* LAB0_HASHIDX_H */
@@ -0,0 +1,187 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "hash.h"
+#include "intern.h"
+
+/* Smallest table, in slots */
+#define IN_MIN_CAPACITY 16
+
+/******** Utility Zone ********/
+
+static inline size_t slot_of(intern_t *pool, uint32_t hash)
+{
+    return hash & (pool->capacity - 1);
+}
+
+static inline in_entry_t *entry_of(char *s)
+{
+    return (in_entry_t *) (s - offsetof(in_entry_t, str));
+}
+
+static in_entry_t **create_slots(size_t capacity)
+{
+    in_entry_t **slots = malloc(capacity * sizeof(in_entry_t *));
+    if (!slots)
+        return NULL;
+
+    memset(slots, 0, capacity * sizeof(in_entry_t *));
+
+    return slots;
+}
+
+/* Return the slot holding string s, or the empty slot where it belongs */
+static in_entry_t **lookup(intern_t *pool, uint32_t hash, const char *s)
+{
+    size_t i = slot_of(pool, hash);
+    while (pool->slots[i]) {
+        if (pool->slots[i]->hash == hash && !strcmp(pool->slots[i]->str, s))
+            break;
+        i = (i + 1) & (pool->capacity - 1);
+    }
+
+    return &pool->slots[i];
+}
+
+/* Move every entry to a table twice as large */
+static bool grow(intern_t *pool)
+{
+    size_t capacity = pool->capacity * 2;
+    in_entry_t **slots = create_slots(capacity);
+    if (!slots)
+        return false;
+
+    for (size_t i = 0; i < pool->capacity; i++) {
+        in_entry_t *entry = pool->slots[i];
+        if (!entry)
+            continue;
+        size_t j = entry->hash & (capacity - 1);
+        while (slots[j])
+            j = (j + 1) & (capacity - 1);
+        slots[j] = entry;
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->capacity = capacity;
+
+    return true;
+}
+
+/******** End of Utility Zone ********/
+
+intern_t *in_new()
+{
+    intern_t *pool = malloc(sizeof(intern_t));
+    if (!pool)
+        return NULL;
+
+    pool->slots = create_slots(IN_MIN_CAPACITY);
+    if (!pool->slots) {
+        free(pool);
+        return NULL;
+    }
+    pool->capacity = IN_MIN_CAPACITY;
+    pool->count = 0;
+    pool->bytes = 0;
+    pool->saved = 0;
+
+    return pool;
+}
+
+void in_free(intern_t *pool)
+{
+    if (!pool)
+        return;
+
+    for (size_t i = 0; i < pool->capacity; i++)
+        free(pool->slots[i]);
+    free(pool->slots);
+    free(pool);
+}
+
+char *in_acquire(intern_t *pool, const char *s)
+{
+    uint32_t hash = hash_str(s);
+    in_entry_t **slot = lookup(pool, hash, s);
+    size_t len = strlen(s) + 1;
+    if (*slot) {
+        (*slot)->refs++;
+        pool->saved += len;
+        return (*slot)->str;
+    }
+
+    /* Keep the load at most 1/2 */
+    if ((pool->count + 1) * 2 > pool->capacity) {
+        if (!grow(pool))
+            return NULL;
+        slot = lookup(pool, hash, s);
+    }
+
+    in_entry_t *entry = malloc(sizeof(in_entry_t) + len);
+    if (!entry)
+        return NULL;
+
+    entry->refs = 1;
+    entry->hash = hash;
+    memcpy(entry->str, s, len);
+    *slot = entry;
+    pool->count++;
+    pool->bytes += len;
+
+    return entry->str;
+}
+
+char *in_find(intern_t *pool, const char *s)
+{
+    in_entry_t *entry = *lookup(pool, hash_str(s), s);
+
+    return entry ? entry->str : NULL;
+}
+
+void in_release(intern_t *pool, char *s)
+{
+    in_entry_t *entry = entry_of(s);
+    size_t len = strlen(s) + 1;
+    if (--entry->refs > 0) {
+        pool->saved -= len;
+        return;
+    }
+
+    /*
+     * Last holder gone: shift back every following entry of the cluster
+     * whose home slot lies at or before the hole, as in hashidx.c.
+     */
+    size_t mask = pool->capacity - 1;
+    size_t i = slot_of(pool, entry->hash);
+    while (pool->slots[i] != entry)
+        i = (i + 1) & mask;
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (!pool->slots[j])
+            break;
+
+        size_t k = slot_of(pool, pool->slots[j]->hash);
+        bool movable = i <= j ? (k <= i || k > j) : (k <= i && k > j);
+        if (movable) {
+            pool->slots[i] = pool->slots[j];
+            i = j;
+        }
+    }
+    pool->slots[i] = NULL;
+    pool->count--;
+    pool->bytes -= len;
+
+    free(entry);
+}
+
+size_t in_memory(intern_t *pool)
+{
+    if (!pool)
+        return 0;
+
+    return sizeof(intern_t) + pool->capacity * sizeof(in_entry_t *) +
+           pool->count * sizeof(in_entry_t) + pool->bytes;
+}
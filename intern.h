@@ -0,0 +1,61 @@
+#ifndef LAB0_INTERN_H
+#define LAB0_INTERN_H
+
+/*
+ * Interning pool sharing one reference-counted copy of every distinct string.
+ *
+ * Each string lives in a single allocation behind a small header holding its
+ * reference count and hash, and the pool finds it again through an
+ * open-addressing table of such headers.  Storing a value that is already
+ * there only bumps its count, and two interned strings are equal exactly when
+ * they are the same pointer.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    size_t refs;   /* Number of holders of the string */
+    uint32_t hash; /* Cached hash of str */
+    char str[];
+} in_entry_t;
+
+typedef struct intern {
+    in_entry_t **slots;
+    size_t capacity; /* Always a power of two */
+    size_t count;    /* Number of distinct strings */
+    size_t bytes;    /* Bytes of string data held, terminators included */
+    size_t saved;    /* Bytes a private copy per holder would have added */
+} intern_t;
+
+/*
+ * Create an empty pool.
+ * Return NULL if could not allocate space.
+ */
+intern_t *in_new();
+
+/* Free the pool and every string in it, however many holders are left */
+void in_free(intern_t *pool);
+
+/*
+ * Return the pooled copy of s, taking one reference to it.
+ * Return NULL if could not allocate space.
+ */
+char *in_acquire(intern_t *pool, const char *s);
+
+/*
+ * Return the pooled copy of s without taking a reference.
+ * Return NULL if s is not in the pool.
+ */
+char *in_find(intern_t *pool, const char *s);
+
+/*
+ * Drop one reference to the pooled string s, freeing it with the last one.
+ */
+void in_release(intern_t *pool, char *s);
+
+/* Return number of bytes used by the pool, strings included */
+size_t in_memory(intern_t *pool);
+
+#endif /* LAB0_INTERN_H */
@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "lfqueue.h"
+
+/* Every shared access is sequentially consistent, for simplicity's sake */
+#define LOAD(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define STORE(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define CAS(p, expected, desired)                                  \
+    __extension__({                                                \
+        __typeof__(*(p)) __exp = (expected);                       \
+        __atomic_compare_exchange_n(p, &__exp, desired, false,     \
+                                    __ATOMIC_SEQ_CST,              \
+                                    __ATOMIC_SEQ_CST);             \
+    })
+
+/******** Utility Zone ********/
+
+static list_ele_t *create_element(char *s)
+{
+    list_ele_t *e = malloc(sizeof(list_ele_t));
+    if (!e)
+        return NULL;
+
+    e->value = NULL;
+    if (s) {
+        e->value = strdup(s);
+        if (!e->value) {
+            free(e);
+            return NULL;
+        }
+    }
+    e->next = NULL;
+    e->prev = NULL;
+    e->sib_next = NULL;
+    e->sib_prev = NULL;
+
+    return e;
+}
+
+/*
+ * Announce that p is about to be read and check it is still reachable from
+ * *src, which guarantees it was not retired before the announcement.
+ * Return the announced pointer, or NULL if *src moved and the caller should
+ * retry.
+ */
+static list_ele_t *protect(lfq_handle_t *h,
+                           int slot,
+                           list_ele_t **src,
+                           list_ele_t *p)
+{
+    STORE(&h->hazard[slot], p);
+    return LOAD(src) == p ? p : NULL;
+}
+
+static bool is_hazardous(lfqueue_t *lfq, list_ele_t *e)
+{
+    for (lfq_handle_t *h = LOAD(&lfq->handles); h; h = h->next) {
+        for (int i = 0; i < LFQ_HAZARDS; i++) {
+            if (LOAD(&h->hazard[i]) == e)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/* Free every retired element of h that no thread announces any more */
+static void scan(lfqueue_t *lfq, lfq_handle_t *h)
+{
+    list_ele_t *keep = NULL;
+    int nkeep = 0;
+    while (h->retired) {
+        list_ele_t *e = h->retired;
+        h->retired = e->sib_next;
+        if (is_hazardous(lfq, e)) {
+            e->sib_next = keep;
+            keep = e;
+            nkeep++;
+        } else {
+            free(e);
+        }
+    }
+
+    h->retired = keep;
+    h->nretired = nkeep;
+}
+
+/* The value of a retired element has gone with its remover already */
+static void retire(lfqueue_t *lfq, lfq_handle_t *h, list_ele_t *e)
+{
+    e->sib_next = h->retired;
+    h->retired = e;
+    if (++h->nretired >= LFQ_RETIRE_BATCH)
+        scan(lfq, h);
+}
+
+/******** End of Utility Zone ********/
+
+lfqueue_t *lfq_new()
+{
+    lfqueue_t *lfq = malloc(sizeof(lfqueue_t));
+    if (!lfq)
+        return NULL;
+
+    list_ele_t *dummy = create_element(NULL);
+    if (!dummy) {
+        free(lfq);
+        return NULL;
+    }
+
+    lfq->head = dummy;
+    lfq->tail = dummy;
+    lfq->handles = NULL;
+
+    return lfq;
+}
+
+void lfq_free(lfqueue_t *lfq)
+{
+    if (!lfq)
+        return;
+
+    /* The dummy's value, if any, belongs to whoever removed it */
+    list_ele_t *e = lfq->head;
+    list_ele_t *next = e->next;
+    free(e);
+    for (e = next; e; e = next) {
+        next = e->next;
+        free(e->value);
+        free(e);
+    }
+
+    lfq_handle_t *h = lfq->handles;
+    while (h) {
+        while (h->retired) {
+            list_ele_t *old = h->retired;
+            h->retired = old->sib_next;
+            free(old);
+        }
+
+        lfq_handle_t *old = h;
+        h = h->next;
+        free(old);
+    }
+
+    free(lfq);
+}
+
+lfq_handle_t *lfq_attach(lfqueue_t *lfq)
+{
+    for (lfq_handle_t *h = LOAD(&lfq->handles); h; h = h->next) {
+        if (!LOAD(&h->active) && CAS(&h->active, 0, 1))
+            return h;
+    }
+
+    lfq_handle_t *h = malloc(sizeof(lfq_handle_t));
+    if (!h)
+        return NULL;
+
+    memset(h, 0, sizeof(lfq_handle_t));
+    h->active = 1;
+
+    /* Handles are only ever pushed, so a plain CAS loop suffices */
+    lfq_handle_t *first;
+    do {
+        first = LOAD(&lfq->handles);
+        h->next = first;
+    } while (!CAS(&lfq->handles, first, h));
+
+    return h;
+}
+
+void lfq_detach(lfqueue_t *lfq, lfq_handle_t *h)
+{
+    for (int i = 0; i < LFQ_HAZARDS; i++)
+        STORE(&h->hazard[i], NULL);
+
+    /* Whatever is still announced stays for the next owner or lfq_free */
+    scan(lfq, h);
+    STORE(&h->active, 0);
+}
+
+bool lfq_insert_tail(lfqueue_t *lfq, lfq_handle_t *h, char *s)
+{
+    list_ele_t *e = create_element(s);
+    if (!e)
+        return false;
+
+    while (true) {
+        list_ele_t *tail = protect(h, 0, &lfq->tail, LOAD(&lfq->tail));
+        if (!tail)
+            continue;
+
+        list_ele_t *next = LOAD(&tail->next);
+        if (LOAD(&lfq->tail) != tail)
+            continue;
+
+        if (next) {
+            /* Tail is lagging: help it forward, then retry */
+            CAS(&lfq->tail, tail, next);
+            continue;
+        }
+
+        if (CAS(&tail->next, NULL, e)) {
+            CAS(&lfq->tail, tail, e);
+            break;
+        }
+    }
+    STORE(&h->hazard[0], NULL);
+
+    return true;
+}
+
+bool lfq_remove_head(lfqueue_t *lfq,
+                     lfq_handle_t *h,
+                     char *sp,
+                     size_t bufsize)
+{
+    list_ele_t *head;
+    char *value;
+    while (true) {
+        head = protect(h, 0, &lfq->head, LOAD(&lfq->head));
+        if (!head)
+            continue;
+
+        list_ele_t *tail = LOAD(&lfq->tail);
+        list_ele_t *next = protect(h, 1, &head->next, LOAD(&head->next));
+        if (LOAD(&lfq->head) != head)
+            continue;
+
+        if (!next) {
+            STORE(&h->hazard[0], NULL);
+            STORE(&h->hazard[1], NULL);
+            return false;
+        }
+
+        if (head == tail) {
+            /* Tail is lagging behind an element about to be removed */
+            CAS(&lfq->tail, tail, next);
+            continue;
+        }
+
+        /* Read before the swing: next may be removed and freed right after */
+        value = LOAD(&next->value);
+        if (CAS(&lfq->head, head, next))
+            break;
+    }
+    STORE(&h->hazard[0], NULL);
+    STORE(&h->hazard[1], NULL);
+
+    /* Winning the swing hands over the value; next is the dummy now */
+    if (sp) {
+        strncpy(sp, value, bufsize - 1);
+        sp[bufsize - 1] = '\0';
+    }
+    free(value);
+    retire(lfq, h, head);
+
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef LAB0_LFQUEUE_H
+#define LAB0_LFQUEUE_H
+
+/*
+ * Lock-free multi-producer/multi-consumer queue after Michael and Scott.
+ *
+ * The list_ele_t chain always starts with a dummy element; insertions
+ * append with a compare-and-swap on the last next link and swing the tail,
+ * removals swing the head to the next element, which becomes the new
+ * dummy.  A thread that finds the tail lagging helps it forward, so no
+ * thread ever waits for another.
+ *
+ * Removed elements are reclaimed with hazard pointers: every thread
+ * announces the (at most two) elements it is about to read, and retired
+ * elements are only freed once no announcement names them.  Threads take
+ * a handle holding their announcements with lfq_attach before touching
+ * the queue.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cacheline.h"
+#include "queue.h"
+
+/* Hazard pointers per thread: the head or tail, and its successor */
+#define LFQ_HAZARDS 2
+
+/* Retired elements a thread keeps before trying to free them */
+#define LFQ_RETIRE_BATCH 64
+
+/* Per-thread record of hazard pointers and retired elements */
+typedef struct lfq_handle {
+    list_ele_t *hazard[LFQ_HAZARDS];
+    list_ele_t *retired; /* Chained through sib_next */
+    int nretired;
+    int active; /* Taken by a thread */
+    struct lfq_handle *next;
+    CACHE_PAD(pad, 0);
+} lfq_handle_t;
+
+typedef struct {
+    list_ele_t *head; /* The dummy element */
+    CACHE_PAD(pad0, sizeof(list_ele_t *));
+    list_ele_t *tail; /* Last element, or lagging one behind */
+    CACHE_PAD(pad1, sizeof(list_ele_t *));
+    lfq_handle_t *handles; /* Every handle ever taken, never shrinking */
+} lfqueue_t;
+
+/*
+ * Create empty queue.
+ * Return NULL if could not allocate space.
+ */
+lfqueue_t *lfq_new();
+
+/*
+ * Free ALL storage used by queue.  No thread may be using it.
+ * No effect if lfq is NULL
+ */
+void lfq_free(lfqueue_t *lfq);
+
+/*
+ * Take a handle for the calling thread, reusing a released one if any.
+ * Return NULL if could not allocate space.
+ */
+lfq_handle_t *lfq_attach(lfqueue_t *lfq);
+
+/* Release the handle of the calling thread */
+void lfq_detach(lfqueue_t *lfq, lfq_handle_t *h);
+
+/*
+ * Attempt to insert element at tail of queue.
+ * Return true if successful.
+ * Return false if could not allocate space.
+ * Argument s points to the string to be stored.
+ */
+bool lfq_insert_tail(lfqueue_t *lfq, lfq_handle_t *h, char *s);
+
+/*
+ * Attempt to remove element from head of queue.
+ * Return true if successful.
+ * Return false if queue is empty.
+ * If sp is non-NULL and an element is removed, copy the removed string to *sp
+ * (up to a maximum of bufsize-1 characters, plus a null terminator.)
+ */
+bool lfq_remove_head(lfqueue_t *lfq,
+                     lfq_handle_t *h,
+                     char *sp,
+                     size_t bufsize);
+
+#endif /* LAB0_LFQUEUE_H */
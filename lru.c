@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "lru.h"
+
+/******** Utility Zone ********/
+
+static inline size_t entry_bytes(lru_entry_t *ent)
+{
+    return strlen(ent->ele.value) + strlen(ent->data) + 2;
+}
+
+static inline bool over_capacity(lru_t *c)
+{
+    if (!c->limit)
+        return false;
+
+    size_t used = c->limit_bytes ? c->bytes : q_size(c->q);
+    return used > c->limit;
+}
+
+/*
+ * Allocate an entry, its key and its value.  The key and the value share
+ * one block, which the queue frees as the element's value.
+ */
+static lru_entry_t *create_entry(char *key, char *data)
+{
+    lru_entry_t *ent = malloc(sizeof(lru_entry_t));
+    if (!ent)
+        return NULL;
+
+    size_t klen = strlen(key), dlen = strlen(data);
+    char *block = malloc(klen + dlen + 2);
+    if (!block) {
+        free(ent);
+        return NULL;
+    }
+    memcpy(block, key, klen + 1);
+    memcpy(block + klen + 1, data, dlen + 1);
+
+    ent->ele.value = block;
+    ent->ele.next = NULL;
+    ent->ele.prev = NULL;
+    ent->ele.sib_next = NULL;
+    ent->ele.sib_prev = NULL;
+    ent->data = block + klen + 1;
+
+    return ent;
+}
+
+/* Take ent out of the cache and free it */
+static void drop_entry(lru_t *c, lru_entry_t *ent)
+{
+    c->bytes -= entry_bytes(ent);
+    q_unlink(c->q, &ent->ele);
+    free(ent->ele.value);
+    free(ent);
+}
+
+/******** End of Utility Zone ********/
+
+lru_t *lru_new(size_t limit, bool bytes)
+{
+    lru_t *c = malloc(sizeof(lru_t));
+    if (!c)
+        return NULL;
+
+    c->q = q_new();
+    if (!c->q || !q_enable_index(c->q)) {
+        q_free(c->q);
+        free(c);
+        return NULL;
+    }
+    c->limit = limit;
+    c->limit_bytes = bytes;
+    c->bytes = 0;
+    c->hits = 0;
+    c->misses = 0;
+    c->evictions = 0;
+
+    return c;
+}
+
+void lru_free(lru_t *c)
+{
+    if (!c)
+        return;
+
+    /* Entries start with their element, so the queue frees them whole */
+    q_free(c->q);
+    free(c);
+}
+
+char *lru_get(lru_t *c, char *key)
+{
+    if (!c)
+        return NULL;
+
+    lru_entry_t *ent = (lru_entry_t *) q_find(c->q, key);
+    if (!ent) {
+        c->misses++;
+        return NULL;
+    }
+
+    c->hits++;
+    q_move_head(c->q, &ent->ele);
+
+    return ent->data;
+}
+
+bool lru_put(lru_t *c, char *key, char *data)
+{
+    if (!c)
+        return false;
+
+    size_t size = strlen(key) + strlen(data) + 2;
+    if (c->limit && (c->limit_bytes ? size > c->limit : c->limit < 1))
+        return false;
+
+    lru_entry_t *ent = create_entry(key, data);
+    if (!ent)
+        return false;
+
+    /* Link the new entry first, so that failing leaves the old one */
+    lru_entry_t *old = (lru_entry_t *) q_find(c->q, key);
+    if (!q_link_head(c->q, &ent->ele)) {
+        free(ent->ele.value);
+        free(ent);
+        return false;
+    }
+    c->bytes += size;
+    if (old)
+        drop_entry(c, old);
+
+    while (over_capacity(c)) {
+        drop_entry(c, (lru_entry_t *) c->q->tail);
+        c->evictions++;
+    }
+
+    return true;
+}
+
+bool lru_remove(lru_t *c, char *key)
+{
+    if (!c)
+        return false;
+
+    lru_entry_t *ent = (lru_entry_t *) q_find(c->q, key);
+    if (!ent)
+        return false;
+
+    drop_entry(c, ent);
+
+    return true;
+}
+
+size_t lru_size(lru_t *c)
+{
+    return c ? q_size(c->q) : 0;
+}
@@ -0,0 +1,77 @@
+#ifndef LAB0_LRU_H
+#define LAB0_LRU_H
+
+/*
+ * Least-recently-used cache mapping string keys to string values.
+ *
+ * Entries sit in a queue_t with a hash index, the most recently used at the
+ * head.  Each entry embeds the list element whose value is its key, so the
+ * index finds it in O(1), and a hit moves it to the head by relinking it in
+ * place.  Once the cache holds more than its capacity, in entries or in
+ * bytes of keys and values, entries are evicted from the tail.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "queue.h"
+
+typedef struct {
+    list_ele_t ele; /* Element holding the key, so it must come first */
+    char *data;     /* Value, allocated together with the key */
+} lru_entry_t;
+
+typedef struct {
+    queue_t *q;       /* Entries, most recently used first */
+    size_t limit;     /* Capacity in entries or bytes, 0 if unbounded */
+    bool limit_bytes; /* Whether limit counts bytes */
+    size_t bytes;     /* Length of keys and values, terminators included */
+    long hits;
+    long misses;
+    long evictions;
+} lru_t;
+
+/*
+ * Create empty cache holding at most limit entries, or limit bytes of keys
+ * and values (terminators included) if bytes is true.  A limit of 0 makes
+ * it unbounded.
+ * Return NULL if could not allocate space.
+ */
+lru_t *lru_new(size_t limit, bool bytes);
+
+/*
+ * Free ALL storage used by cache.
+ * No effect if c is NULL
+ */
+void lru_free(lru_t *c);
+
+/*
+ * Look up key, making its entry the most recently used.
+ * Return its value, valid until the entry is replaced or evicted.
+ * Return NULL if c is NULL or key is absent.
+ */
+char *lru_get(lru_t *c, char *key);
+
+/*
+ * Map key to a copy of data, replacing any value it had, and make it the
+ * most recently used.  Evict least recently used entries until the cache
+ * respects its capacity again.
+ * Return true if successful.
+ * Return false if c is NULL, the entry alone exceeds the capacity or could
+ * not allocate space.
+ */
+bool lru_put(lru_t *c, char *key, char *data);
+
+/*
+ * Remove the entry of key.
+ * Return false if c is NULL or key is absent.
+ */
+bool lru_remove(lru_t *c, char *key);
+
+/*
+ * Return number of entries in cache.
+ * Return 0 if c is NULL
+ */
+size_t lru_size(lru_t *c);
+
+#endif /* LAB0_LRU_H */
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "harness.h"
+#include "mqueue.h"
+
+/* Stamps each shard has room for at first */
+#define MQ_MIN_CAPACITY 16
+
+#define EMPTY UINT64_MAX
+
+/******** Utility Zone ********/
+
+static inline uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* xorshift32 */
+static inline uint32_t next_random(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static inline uint64_t peek_top(mq_shard_t *sh)
+{
+    return __atomic_load_n(&sh->top, __ATOMIC_RELAXED);
+}
+
+static inline void set_top(mq_shard_t *sh, uint64_t stamp)
+{
+    __atomic_store_n(&sh->top, stamp, __ATOMIC_RELAXED);
+}
+
+/* Double the stamp ring of a shard whose ring is full.  Lock held */
+static bool grow_stamps(mq_shard_t *sh)
+{
+    size_t capacity = sh->capacity * 2;
+    uint64_t *stamps = malloc(capacity * sizeof(uint64_t));
+    if (!stamps)
+        return false;
+
+    for (size_t i = 0; i < sh->capacity; i++)
+        stamps[i] = sh->stamps[(sh->first + i) & (sh->capacity - 1)];
+    free(sh->stamps);
+    sh->stamps = stamps;
+    sh->first = 0;
+    sh->capacity = capacity;
+
+    return true;
+}
+
+/* Append s to a shard.  Lock held */
+static bool push(mq_shard_t *sh, char *s)
+{
+    size_t size = sh->q->size;
+    if (size == sh->capacity && !grow_stamps(sh))
+        return false;
+    if (!q_insert_tail(sh->q, s))
+        return false;
+
+    uint64_t stamp = now_ns();
+    sh->stamps[(sh->first + size) & (sh->capacity - 1)] = stamp;
+    if (!size)
+        set_top(sh, stamp);
+
+    return true;
+}
+
+/******** End of Utility Zone ********/
+
+mqueue_t *mq_new(int shards)
+{
+    if (shards < 1)
+        return NULL;
+
+    mqueue_t *mq = malloc(sizeof(mqueue_t));
+    if (!mq)
+        return NULL;
+
+    mq->shards = malloc(shards * sizeof(mq_shard_t));
+    if (!mq->shards) {
+        free(mq);
+        return NULL;
+    }
+
+    for (mq->count = 0; mq->count < shards; mq->count++) {
+        mq_shard_t *sh = &mq->shards[mq->count];
+        sh->q = q_new();
+        sh->stamps = malloc(MQ_MIN_CAPACITY * sizeof(uint64_t));
+        if (!sh->q || !sh->stamps) {
+            q_free(sh->q);
+            free(sh->stamps);
+            mq_free(mq);
+            return NULL;
+        }
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->top = EMPTY;
+        sh->first = 0;
+        sh->capacity = MQ_MIN_CAPACITY;
+    }
+
+    return mq;
+}
+
+void mq_free(mqueue_t *mq)
+{
+    if (!mq)
+        return;
+
+    for (int i = 0; i < mq->count; i++) {
+        q_free(mq->shards[i].q);
+        free(mq->shards[i].stamps);
+        pthread_mutex_destroy(&mq->shards[i].lock);
+    }
+    free(mq->shards);
+    free(mq);
+}
+
+bool mq_insert(mqueue_t *mq, uint32_t *seed, char *s)
+{
+    if (!mq)
+        return false;
+
+    /* Skip shards busy with other threads, but settle on one eventually */
+    mq_shard_t *sh;
+    int tries = 0;
+    while (true) {
+        sh = &mq->shards[next_random(seed) % mq->count];
+        if (!pthread_mutex_trylock(&sh->lock))
+            break;
+        if (++tries == mq->count) {
+            pthread_mutex_lock(&sh->lock);
+            break;
+        }
+    }
+
+    bool ok = push(sh, s);
+    pthread_mutex_unlock(&sh->lock);
+
+    return ok;
+}
+
+bool mq_insert_shard(mqueue_t *mq, int shard, char *s)
+{
+    if (!mq)
+        return false;
+
+    mq_shard_t *sh = &mq->shards[shard % mq->count];
+    pthread_mutex_lock(&sh->lock);
+    bool ok = push(sh, s);
+    pthread_mutex_unlock(&sh->lock);
+
+    return ok;
+}
+
+bool mq_remove(mqueue_t *mq, uint32_t *seed, char *sp, size_t bufsize)
+{
+    if (!mq)
+        return false;
+
+    while (true) {
+        mq_shard_t *a = &mq->shards[next_random(seed) % mq->count];
+        mq_shard_t *b = &mq->shards[next_random(seed) % mq->count];
+        mq_shard_t *sh = peek_top(a) <= peek_top(b) ? a : b;
+
+        if (peek_top(sh) == EMPTY) {
+            /* Both samples look empty: give up only if every shard does */
+            int i = 0;
+            while (i < mq->count && peek_top(&mq->shards[i]) == EMPTY)
+                i++;
+            if (i == mq->count)
+                return false;
+            continue;
+        }
+
+        if (pthread_mutex_trylock(&sh->lock))
+            continue;
+
+        /* Emptied since it was sampled */
+        if (!sh->q->size) {
+            pthread_mutex_unlock(&sh->lock);
+            continue;
+        }
+
+        q_remove_head(sh->q, sp, bufsize);
+        sh->first = (sh->first + 1) & (sh->capacity - 1);
+        set_top(sh, sh->q->size ? sh->stamps[sh->first] : EMPTY);
+        pthread_mutex_unlock(&sh->lock);
+
+        return true;
+    }
+}
+
+size_t mq_size(mqueue_t *mq)
+{
+    if (!mq)
+        return 0;
+
+    size_t size = 0;
+    for (int i = 0; i < mq->count; i++) {
+        pthread_mutex_lock(&mq->shards[i].lock);
+        size += mq->shards[i].q->size;
+        pthread_mutex_unlock(&mq->shards[i].lock);
+    }
+
+    return size;
+}
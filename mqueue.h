@@ -0,0 +1,86 @@
+#ifndef LAB0_MQUEUE_H
+#define LAB0_MQUEUE_H
+
+/*
+ * Relaxed FIFO queue after the MultiQueue of Rihani, Sanders and Dementiev.
+ *
+ * The strings are spread over independent shards, each a queue_t under its
+ * own lock, so threads mostly work on different shards instead of queueing
+ * up on one lock.  Every element is stamped with its insertion time, and
+ * each shard publishes the stamp of its head.  A removal samples two
+ * shards at random and takes the head of the one holding the older
+ * element, which keeps the order close to FIFO: with c shards per thread,
+ * the element removed is on average among the first few c * threads
+ * elements.  A shard already locked by another thread is not waited for;
+ * another one is sampled instead.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cacheline.h"
+#include "queue.h"
+
+typedef struct {
+    uint64_t top; /* Stamp of the head, UINT64_MAX if empty; read unlocked */
+    pthread_mutex_t lock;
+    queue_t *q;
+    uint64_t *stamps; /* Ring of the stamps of q, the head's at first */
+    size_t first;
+    size_t capacity; /* Always a power of two */
+    CACHE_PAD(pad,
+              2 * sizeof(uint64_t) + sizeof(pthread_mutex_t) +
+                  sizeof(queue_t *) + 2 * sizeof(size_t));
+} mq_shard_t;
+
+typedef struct {
+    int count;
+    mq_shard_t *shards;
+} mqueue_t;
+
+/*
+ * Create empty queue of the given number of shards.
+ * Return NULL if shards is not positive or could not allocate space.
+ */
+mqueue_t *mq_new(int shards);
+
+/*
+ * Free ALL storage used by queue.  No thread may be using it.
+ * No effect if mq is NULL
+ */
+void mq_free(mqueue_t *mq);
+
+/*
+ * Attempt to insert element into a random shard.  seed holds the calling
+ * thread's random state and must not be shared with other threads.
+ * Return true if successful.
+ * Return false if mq is NULL or could not allocate space.
+ */
+bool mq_insert(mqueue_t *mq, uint32_t *seed, char *s);
+
+/*
+ * Attempt to insert element into the given shard, so that a thread may
+ * keep to the shards near it.
+ * Return true if successful.
+ * Return false if mq is NULL or could not allocate space.
+ */
+bool mq_insert_shard(mqueue_t *mq, int shard, char *s);
+
+/*
+ * Attempt to remove the head of the older of two random shards.
+ * Return true if successful.
+ * Return false if mq is NULL or every shard looked empty.
+ * If sp is non-NULL and an element is removed, copy the removed string to *sp
+ * (up to a maximum of bufsize-1 characters, plus a null terminator.)
+ */
+bool mq_remove(mqueue_t *mq, uint32_t *seed, char *sp, size_t bufsize);
+
+/*
+ * Return number of elements in queue, which is only a snapshot while other
+ * threads use it.  Return 0 if mq is NULL or empty
+ */
+size_t mq_size(mqueue_t *mq);
+
+#endif /* LAB0_MQUEUE_H */
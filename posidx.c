@@ -0,0 +1,337 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "blob.h"
+#include "harness.h"
+#include "posidx.h"
+
+/******** Utility Zone ********/
+
+/* Measure as queue.c does, so that the spans add up to the queue's bytes */
+static inline size_t ele_bytes(posidx_t *pi, list_ele_t *e)
+{
+    const char *v = e->value;
+    return (bl_owns(pi->blobs, v) ? bl_length(v) : strlen(v)) + 1;
+}
+
+static inline pos_span_t span_add(pos_span_t a, pos_span_t b)
+{
+    return (pos_span_t){a.count + b.count, a.bytes + b.bytes};
+}
+
+static inline pos_span_t span_sub(pos_span_t a, pos_span_t b)
+{
+    return (pos_span_t){a.count - b.count, a.bytes - b.bytes};
+}
+
+/* Draw tower heights from a geometric distribution with p = 1/4 */
+static int random_height(posidx_t *pi)
+{
+    /* xorshift32 */
+    uint32_t x = pi->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pi->seed = x;
+
+    int h = 0;
+    while ((x & 3) == 0 && h < POS_MAX_LEVEL) {
+        h++;
+        x >>= 2;
+    }
+    return h;
+}
+
+static ptower_t *create_tower(list_ele_t *e, int height)
+{
+    ptower_t *t = malloc(sizeof(ptower_t) + height * sizeof(t->link[0]));
+    if (!t)
+        return NULL;
+
+    t->ele = e;
+    t->height = height;
+    for (int l = 0; l < height; l++) {
+        t->link[l].next = NULL;
+        t->link[l].span = (pos_span_t){0, 0};
+    }
+
+    return t;
+}
+
+/* Sentinel of an index over an empty chain */
+static ptower_t *create_sentinel()
+{
+    ptower_t *s = create_tower(NULL, POS_MAX_LEVEL);
+    if (!s)
+        return NULL;
+
+    for (int l = 0; l < POS_MAX_LEVEL; l++)
+        s->link[l].span = (pos_span_t){1, 0};
+
+    return s;
+}
+
+/*
+ * Find the last tower before internal position t on every level, and the
+ * offset of each from the sentinel.
+ */
+static void find(posidx_t *pi, size_t t, ptower_t **update, pos_span_t *off)
+{
+    ptower_t *x = pi->head;
+    pos_span_t o = {0, 0};
+    for (int l = POS_MAX_LEVEL - 1; l >= 0; l--) {
+        while (x->link[l].next && o.count + x->link[l].span.count < t) {
+            o = span_add(o, x->link[l].span);
+            x = x->link[l].next;
+        }
+        update[l] = x;
+        off[l] = o;
+    }
+}
+
+/*
+ * Walk the chain from tower u, at offset off, to internal position t.
+ * Return the element there, and store its byte offset in bytes.
+ */
+static list_ele_t *walk(posidx_t *pi,
+                        list_ele_t *head,
+                        ptower_t *u,
+                        pos_span_t off,
+                        size_t t,
+                        size_t *bytes)
+{
+    list_ele_t *e = u == pi->head ? head : u->ele;
+    size_t p = u == pi->head ? 1 : off.count;
+    size_t b = off.bytes;
+    for (; p < t; p++, e = e->next)
+        b += ele_bytes(pi, e);
+
+    *bytes = b;
+    return e;
+}
+
+/******** End of Utility Zone ********/
+
+posidx_t *pi_new(list_ele_t *head, struct blobs *blobs)
+{
+    posidx_t *pi = malloc(sizeof(posidx_t));
+    if (!pi)
+        return NULL;
+
+    pi->head = create_sentinel();
+    if (!pi->head) {
+        free(pi);
+        return NULL;
+    }
+    pi->stale = false;
+    pi->seed = 2463534242U;
+    pi->blobs = blobs;
+
+    /* Towers are appended level by level, so remember the last of each */
+    ptower_t *last[POS_MAX_LEVEL];
+    pos_span_t last_off[POS_MAX_LEVEL];
+    for (int l = 0; l < POS_MAX_LEVEL; l++) {
+        last[l] = pi->head;
+        last_off[l] = (pos_span_t){0, 0};
+    }
+
+    pos_span_t o = {1, 0};
+    for (list_ele_t *e = head; e; e = e->next) {
+        int h = random_height(pi);
+        ptower_t *t = h ? create_tower(e, h) : NULL;
+        for (int l = 0; t && l < h; l++) {
+            last[l]->link[l].next = t;
+            last[l]->link[l].span = span_sub(o, last_off[l]);
+            last[l] = t;
+            last_off[l] = o;
+        }
+        o.count++;
+        o.bytes += ele_bytes(pi, e);
+    }
+
+    /* o is now the end of the chain */
+    for (int l = 0; l < POS_MAX_LEVEL; l++)
+        last[l]->link[l].span = span_sub(o, last_off[l]);
+
+    return pi;
+}
+
+void pi_free(posidx_t *pi)
+{
+    if (!pi)
+        return;
+
+    ptower_t *t = pi->head;
+    while (t) {
+        ptower_t *next = t->link[0].next;
+        free(t);
+        t = next;
+    }
+    free(pi);
+}
+
+list_ele_t *pi_at(posidx_t *pi, list_ele_t *head, size_t i, size_t *before)
+{
+    ptower_t *update[POS_MAX_LEVEL];
+    pos_span_t off[POS_MAX_LEVEL];
+    size_t bytes;
+
+    /* The last tower not past the element, which may be its own */
+    find(pi, i + 2, update, off);
+    list_ele_t *e = walk(pi, head, update[0], off[0], i + 1, &bytes);
+    if (before)
+        *before = bytes;
+
+    return e;
+}
+
+void pi_insert(posidx_t *pi, list_ele_t *head, size_t i)
+{
+    ptower_t *update[POS_MAX_LEVEL];
+    pos_span_t off[POS_MAX_LEVEL];
+    size_t t = i + 1;
+
+    /* The spans still reflect the chain without the new element */
+    find(pi, t, update, off);
+    pos_span_t at = {t, 0};
+    list_ele_t *e = walk(pi, head, update[0], off[0], t, &at.bytes);
+    pos_span_t size = {1, ele_bytes(pi, e)};
+
+    int h = random_height(pi);
+    ptower_t *tower = h ? create_tower(e, h) : NULL;
+    if (!tower)
+        h = 0;
+
+    for (int l = 0; l < POS_MAX_LEVEL; l++) {
+        if (l >= h) {
+            update[l]->link[l].span = span_add(update[l]->link[l].span, size);
+            continue;
+        }
+
+        /* Where the next tower, or the end, lies once e is in */
+        pos_span_t next = span_add(span_add(off[l], update[l]->link[l].span),
+                                   size);
+        tower->link[l].next = update[l]->link[l].next;
+        tower->link[l].span = span_sub(next, at);
+        update[l]->link[l].next = tower;
+        update[l]->link[l].span = span_sub(at, off[l]);
+    }
+}
+
+void pi_remove(posidx_t *pi, list_ele_t *head, size_t i)
+{
+    ptower_t *update[POS_MAX_LEVEL];
+    pos_span_t off[POS_MAX_LEVEL];
+    size_t t = i + 1;
+
+    find(pi, t, update, off);
+    size_t bytes;
+    list_ele_t *e = walk(pi, head, update[0], off[0], t, &bytes);
+    pos_span_t size = {1, ele_bytes(pi, e)};
+
+    /* A tower of e comes right after the last tower before it */
+    ptower_t *tower = update[0]->link[0].next;
+    int h = tower && tower->ele == e ? tower->height : 0;
+
+    for (int l = 0; l < POS_MAX_LEVEL; l++) {
+        pos_span_t span = update[l]->link[l].span;
+        if (l < h) {
+            update[l]->link[l].next = tower->link[l].next;
+            span = span_add(span, tower->link[l].span);
+        }
+        update[l]->link[l].span = span_sub(span, size);
+    }
+    if (h)
+        free(tower);
+}
+
+void pi_rotate(posidx_t *pi, list_ele_t *head, size_t k, size_t n,
+               size_t bytes)
+{
+    if (k == 0 || k >= n)
+        return;
+
+    ptower_t *last_a[POS_MAX_LEVEL], *last_b[POS_MAX_LEVEL];
+    pos_span_t off_a[POS_MAX_LEVEL], off_b[POS_MAX_LEVEL];
+    size_t bytes_a;
+
+    /* The first k elements form part A, the others part B */
+    find(pi, k + 1, last_a, off_a);
+    walk(pi, head, last_a[0], off_a[0], k + 1, &bytes_a);
+    find(pi, n + 1, last_b, off_b);
+
+    /* B moves back by the size of A, and A forward by the size of B */
+    pos_span_t size_a = {k, bytes_a}, size_b = {n - k, bytes - bytes_a};
+    pos_span_t end = {n + 1, bytes};
+
+    ptower_t *s = pi->head;
+    for (int l = 0; l < POS_MAX_LEVEL; l++) {
+        ptower_t *first_a = NULL, *first_b = last_a[l]->link[l].next;
+        pos_span_t at_a = s->link[l].span;
+        pos_span_t at_b = span_add(off_a[l], last_a[l]->link[l].span);
+        if (last_a[l] != s)
+            first_a = s->link[l].next;
+        at_a = span_add(at_a, size_b);
+        at_b = span_sub(at_b, size_a);
+
+        if (first_b) {
+            s->link[l].next = first_b;
+            s->link[l].span = at_b;
+
+            /* The last tower of B on this level leads on into A */
+            pos_span_t last = span_sub(off_b[l], size_a);
+            last_b[l]->link[l].next = first_a;
+            last_b[l]->link[l].span = span_sub(first_a ? at_a : end, last);
+        } else {
+            s->link[l].next = first_a;
+            s->link[l].span = first_a ? at_a : end;
+        }
+
+        if (first_a) {
+            pos_span_t last = span_add(off_a[l], size_b);
+            last_a[l]->link[l].next = NULL;
+            last_a[l]->link[l].span = span_sub(end, last);
+        }
+    }
+}
+
+posidx_t *pi_split(posidx_t *pi, list_ele_t *head, size_t i, size_t n,
+                   size_t bytes, size_t *tail_bytes)
+{
+    posidx_t *tail = malloc(sizeof(posidx_t));
+    if (!tail)
+        return NULL;
+
+    tail->head = create_sentinel();
+    if (!tail->head) {
+        free(tail);
+        return NULL;
+    }
+    tail->stale = false;
+    tail->seed = pi->seed ^ 0x9e3779b9U;
+    tail->blobs = pi->blobs;
+
+    if (i >= n) {
+        *tail_bytes = 0;
+        return tail;
+    }
+
+    ptower_t *last[POS_MAX_LEVEL];
+    pos_span_t off[POS_MAX_LEVEL];
+    pos_span_t cut = {i, 0};
+    find(pi, i + 1, last, off);
+    walk(pi, head, last[0], off[0], i + 1, &cut.bytes);
+    *tail_bytes = bytes - cut.bytes;
+
+    /* The towers from the cut on go over, their spans relative anyway */
+    pos_span_t end = {i + 1, cut.bytes};
+    for (int l = 0; l < POS_MAX_LEVEL; l++) {
+        pos_span_t next = span_add(off[l], last[l]->link[l].span);
+        tail->head->link[l].next = last[l]->link[l].next;
+        tail->head->link[l].span = span_sub(next, cut);
+        last[l]->link[l].next = NULL;
+        last[l]->link[l].span = span_sub(end, off[l]);
+    }
+
+    return tail;
+}
@@ -0,0 +1,93 @@
+#ifndef LAB0_POSIDX_H
+#define LAB0_POSIDX_H
+
+/*
+ * Positional index layered over the list_ele_t chain of a queue.
+ *
+ * It is a skip list ordered by position rather than by value: level 0 is
+ * the chain itself, and an element promoted to higher levels gets a tower
+ * whose every link records how many elements, and how many bytes of their
+ * strings, it skips.  Summing those spans on the way down finds the element
+ * at a position, and its byte offset, in O(log n) expected time; inserting
+ * or removing at a known position only adjusts the spans that cross it.
+ *
+ * Positions are 0-based for callers.  Internally the sentinel sits at 0,
+ * the element at position i at i + 1 and the end of the chain at n + 1.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+/* Number of levels above the chain.  With p = 1/4 this covers 4^16 elements */
+#define POS_MAX_LEVEL 16
+
+/* Distance from a tower to the next one on its level, or to the end */
+typedef struct {
+    size_t count; /* Elements skipped, the tower's own included */
+    size_t bytes; /* Length of their strings, terminators included */
+} pos_span_t;
+
+typedef struct ptower {
+    list_ele_t *ele; /* Element promoted by this tower, NULL for sentinel */
+    int height;      /* Number of levels above the chain */
+    struct {
+        struct ptower *next;
+        pos_span_t span;
+    } link[];
+} ptower_t;
+
+typedef struct posidx {
+    /* Set when the chain changed in ways the spans could not follow */
+    bool stale;
+    uint32_t seed;
+    ptower_t *head; /* Sentinel, as tall as the index may grow */
+    /* Region of the queue, whose values are measured by their headers */
+    struct blobs *blobs;
+} posidx_t;
+
+/*
+ * Create an index for the chain starting at head, whose values may be stored
+ * in region blobs, which may be NULL.
+ * Return NULL if could not allocate space.
+ */
+posidx_t *pi_new(list_ele_t *head, struct blobs *blobs);
+
+/* Free the index and all of its towers.  The chain is left untouched */
+void pi_free(posidx_t *pi);
+
+/*
+ * Return the element at position i of the chain starting at head, which
+ * must hold more than i elements.  If before is non-NULL, store the length
+ * of the strings ahead of it there.
+ */
+list_ele_t *pi_at(posidx_t *pi, list_ele_t *head, size_t i, size_t *before);
+
+/*
+ * Account for the element just linked at position i.  It may be promoted;
+ * a tower that could not be allocated only makes searches a little longer.
+ */
+void pi_insert(posidx_t *pi, list_ele_t *head, size_t i);
+
+/* Account for the element at position i, which is about to be unlinked */
+void pi_remove(posidx_t *pi, list_ele_t *head, size_t i);
+
+/*
+ * Account for the first k of n elements, holding bytes in all, moving
+ * behind the others.  The chain must still be in its old order.
+ */
+void pi_rotate(posidx_t *pi, list_ele_t *head, size_t k, size_t n,
+               size_t bytes);
+
+/*
+ * Split off the index of the elements from position i on, out of n holding
+ * bytes in all; pi keeps the first i.  The chain must still be whole.
+ * tail_bytes receives the length of the strings split off.
+ * Return NULL, leaving pi whole, if could not allocate space.
+ */
+posidx_t *pi_split(posidx_t *pi, list_ele_t *head, size_t i, size_t n,
+                   size_t bytes, size_t *tail_bytes);
+
+#endif /* LAB0_POSIDX_H */
@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "pqueue.h"
+
+/* Initial number of slots in the heap array */
+#define PQ_INIT_CAPACITY 16
+
+/******** Utility Zone ********/
+
+static inline size_t parent(size_t i)
+{
+    return (i - 1) / PQ_ARITY;
+}
+
+static inline size_t first_child(size_t i)
+{
+    return i * PQ_ARITY + 1;
+}
+
+/*
+ * Double the heap array.  There is no test_realloc, so move the pointers
+ * over by hand; the copy is amortized over the insertions that filled it.
+ * Fail rather than let the doubled size overflow.
+ */
+static bool grow(pqueue_t *pq)
+{
+    if (pq->capacity > SIZE_MAX / 2 / sizeof(char *))
+        return false;
+
+    size_t capacity = pq->capacity * 2;
+    char **vals = malloc(capacity * sizeof(char *));
+    if (!vals)
+        return false;
+
+    memcpy(vals, pq->vals, pq->size * sizeof(char *));
+    free(pq->vals);
+    pq->vals = vals;
+    pq->capacity = capacity;
+
+    return true;
+}
+
+/* Move the hole at i up until s fits there */
+static void sift_up(pqueue_t *pq, size_t i, char *s)
+{
+    while (i > 0) {
+        size_t p = parent(i);
+        if (strcmp(pq->vals[p], s) <= 0)
+            break;
+        pq->vals[i] = pq->vals[p];
+        i = p;
+    }
+    pq->vals[i] = s;
+}
+
+/* Move the hole at i down until s fits there */
+static void sift_down(pqueue_t *pq, size_t i, char *s)
+{
+    while (true) {
+        size_t c = first_child(i);
+        if (c >= pq->size)
+            break;
+
+        /* Pick the smallest of up to PQ_ARITY children */
+        size_t last = c + PQ_ARITY < pq->size ? c + PQ_ARITY : pq->size;
+        size_t min = c;
+        for (size_t k = c + 1; k < last; k++) {
+            if (strcmp(pq->vals[k], pq->vals[min]) < 0)
+                min = k;
+        }
+
+        if (strcmp(s, pq->vals[min]) <= 0)
+            break;
+        pq->vals[i] = pq->vals[min];
+        i = min;
+    }
+    pq->vals[i] = s;
+}
+
+/******** End of Utility Zone ********/
+
+/*
+ * Create empty priority queue.
+ * Return NULL if could not allocate space.
+ */
+pqueue_t *pq_new()
+{
+    pqueue_t *pq = malloc(sizeof(pqueue_t));
+    if (!pq)
+        return NULL;
+
+    pq->vals = malloc(PQ_INIT_CAPACITY * sizeof(char *));
+    if (!pq->vals) {
+        free(pq);
+        return NULL;
+    }
+    pq->size = 0;
+    pq->capacity = PQ_INIT_CAPACITY;
+
+    return pq;
+}
+
+/* Free all storage used by priority queue */
+void pq_free(pqueue_t *pq)
+{
+    if (!pq)
+        return;
+
+    for (size_t i = 0; i < pq->size; i++)
+        free(pq->vals[i]);
+    free(pq->vals);
+    free(pq);
+}
+
+/*
+ * Attempt to insert element in O(log n) time.
+ * Return true if successful.
+ * Return false if pq is NULL or could not allocate space.
+ */
+bool pq_insert(pqueue_t *pq, char *s)
+{
+    if (!pq)
+        return false;
+
+    if (pq->size == pq->capacity && !grow(pq))
+        return false;
+
+    size_t len = strlen(s);
+    char *p = malloc(len + 1);
+    if (!p)
+        return false;
+    memcpy(p, s, len + 1);
+
+    pq->size++;
+    sift_up(pq, pq->size - 1, p);
+
+    return true;
+}
+
+/*
+ * Attempt to remove the smallest element in O(log n) time.
+ * Return true if successful.
+ * Return false if pq is NULL or empty.
+ */
+bool pq_remove_min(pqueue_t *pq, char *sp, size_t bufsize)
+{
+    if (!pq || pq->size == 0)
+        return false;
+
+    char *min = pq->vals[0];
+    if (sp) {
+        size_t len = strlen(min);
+        if (len > bufsize - 1)
+            len = bufsize - 1;
+        memcpy(sp, min, len);
+        sp[len] = 0;
+    }
+    free(min);
+
+    /* Refill the root with the last leaf */
+    pq->size--;
+    if (pq->size > 0)
+        sift_down(pq, 0, pq->vals[pq->size]);
+
+    return true;
+}
+
+/*
+ * Return the smallest element in O(1) time.
+ * Return NULL if pq is NULL or empty.
+ */
+char *pq_peek_min(pqueue_t *pq)
+{
+    return pq && pq->size > 0 ? pq->vals[0] : NULL;
+}
+
+/*
+ * Return number of elements in priority queue.
+ * Return 0 if pq is NULL or empty
+ */
+size_t pq_size(pqueue_t *pq)
+{
+    return pq ? pq->size : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef LAB0_PQUEUE_H
+#define LAB0_PQUEUE_H
+
+/*
+ * This program implements a priority queue of strings, always handing out
+ * the smallest one first.
+ *
+ * It uses a 4-ary min-heap stored in a contiguous array of value pointers.
+ * A wider node makes the heap shallower, so removals touch fewer cache lines
+ * than with a binary heap.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Number of children per heap node */
+#define PQ_ARITY 4
+
+/* Priority queue structure */
+typedef struct {
+    char **vals; /* Heap of strings, smallest at vals[0] */
+    size_t size;
+    size_t capacity;
+} pqueue_t;
+
+/* Operations on priority queue */
+
+/*
+ * Create empty priority queue.
+ * Return NULL if could not allocate space.
+ */
+pqueue_t *pq_new();
+
+/*
+ * Free ALL storage used by priority queue.
+ * No effect if pq is NULL
+ */
+void pq_free(pqueue_t *pq);
+
+/*
+ * Attempt to insert element in O(log n) time.
+ * Return true if successful.
+ * Return false if pq is NULL or could not allocate space.
+ * Argument s points to the string to be stored.
+ * The function must explicitly allocate space and copy the string into it.
+ */
+bool pq_insert(pqueue_t *pq, char *s);
+
+/*
+ * Attempt to remove the smallest element in O(log n) time.
+ * Return true if successful.
+ * Return false if pq is NULL or empty.
+ * If sp is non-NULL and an element is removed, copy the removed string to *sp
+ * (up to a maximum of bufsize-1 characters, plus a null terminator.)
+ * The space used by the string should be freed.
+ */
+bool pq_remove_min(pqueue_t *pq, char *sp, size_t bufsize);
+
+/*
+ * Return the smallest element in O(1) time, leaving it in place.
+ * Return NULL if pq is NULL or empty.
+ */
+char *pq_peek_min(pqueue_t *pq);
+
+/*
+ * Return number of elements in priority queue.
+ * Return 0 if pq is NULL or empty
+ */
+size_t pq_size(pqueue_t *pq);
+
+#endif /* LAB0_PQUEUE_H */
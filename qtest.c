@@ -1,6 +1,8 @@
 /* Implementation of testing code for queue code */
 
 #include <getopt.h>
+#include <limits.h>
+#include <locale.h>
 #include <signal.h>
 #include <spawn.h>
 #include <stdio.h>
@@ -32,7 +34,18 @@
 #include "queue.h"
 
 #include "console.h"
+#include "bench.h"
+#include "blob.h"
+#include "bloom.h"
+#include "frozen.h"
+#include "hash.h"
+#include "hashidx.h"
+#include "intern.h"
+#include "lru.h"
+#include "posidx.h"
+#include "pqueue.h"
 #include "report.h"
+#include "twheel.h"
 
 /* Settable parameters */
 
@@ -54,12 +67,50 @@ static queue_t *q = NULL;
 /* Number of elements in queue */
 static size_t qcnt = 0;
 
+/* Region for large values, shared by every queue that uses one */
+static blobs_t *blobs = NULL;
+
+/* Frozen form of a queue, holding strings in front-coded blocks */
+static frozen_t *fz = NULL;
+
+/* Priority queue being tested, alongside the queue */
+static pqueue_t *pq = NULL;
+static size_t pqcnt = 0;
+
+/*
+ * Timing wheel being tested, with every timer scheduled on it by number.
+ * A timer whose handle is NULL was cancelled; one due by the clock has
+ * expired and been popped.
+ */
+typedef struct {
+    tw_timer_t *handle;
+    uint64_t due;
+} wtimer_t;
+static twheel_t *tw = NULL;
+static wtimer_t *wtimers = NULL;
+static int wtcnt = 0;
+static int wtalloc = 0;
+static int wcnt = 0; /* Number of pending timers */
+
+/* LRU cache being tested */
+static lru_t *lc = NULL;
+
+/* Snapshot of the queue, with a fingerprint of its expected contents */
+static snapshot_t *snap = NULL;
+static uint64_t snap_sum = 0;
+static size_t snapcnt = 0;
+
 /* How many times can queue operations fail */
 static int fail_limit = BIG_QUEUE;
 static int fail_count = 0;
 
 static int string_length = MAXSTRING;
 
+/* Capacity and overflow policy of the queue, 0 if unbounded */
+static int capacity = 0;
+static int capacity_bytes = 0;
+static int policy = Q_REJECT;
+
 #define MIN_RANDSTR_LEN 5
 #define MAX_RANDSTR_LEN 10
 static const char charset[] = "abcdefghijklmnopqrstuvwxyz";
@@ -73,11 +124,66 @@ static bool do_insert_tail(int argc, char *argv[]);
 static bool do_remove_head(int argc, char *argv[]);
 static bool do_remove_head_quiet(int argc, char *argv[]);
 static bool do_reverse(int argc, char *argv[]);
+static bool do_shuffle(int argc, char *argv[]);
 static bool do_size(int argc, char *argv[]);
 static bool do_sort(int argc, char *argv[]);
+static bool do_sorted(int argc, char *argv[]);
+static bool do_index(int argc, char *argv[]);
+static bool do_find(int argc, char *argv[]);
+static bool do_bloom(int argc, char *argv[]);
+static bool do_contains(int argc, char *argv[]);
+static bool do_intern(int argc, char *argv[]);
+static bool do_remove_value(int argc, char *argv[]);
+static bool do_dedup(int argc, char *argv[]);
+static bool do_positions(int argc, char *argv[]);
+static bool do_at(int argc, char *argv[]);
+static bool do_delete_at(int argc, char *argv[]);
+static bool do_rotate(int argc, char *argv[]);
+static bool do_split(int argc, char *argv[]);
+static bool do_blobs(int argc, char *argv[]);
+static bool do_freeze(int argc, char *argv[]);
+static bool do_thaw(int argc, char *argv[]);
+static bool do_frozen_remove_head(int argc, char *argv[]);
+static bool do_snap(int argc, char *argv[]);
+static bool do_snap_check(int argc, char *argv[]);
+static bool do_snap_free(int argc, char *argv[]);
+static bool do_bq_bench(int argc, char *argv[]);
+static bool do_lf_bench(int argc, char *argv[]);
+static bool do_spsc_bench(int argc, char *argv[]);
+static bool do_tl_bench(int argc, char *argv[]);
+static bool do_ws_sort(int argc, char *argv[]);
+static bool do_mq_bench(int argc, char *argv[]);
 static bool do_show(int argc, char *argv[]);
+static bool do_bounds(int argc, char *argv[]);
+static bool do_pq_new(int argc, char *argv[]);
+static bool do_pq_free(int argc, char *argv[]);
+static bool do_pq_insert(int argc, char *argv[]);
+static bool do_pq_remove_min(int argc, char *argv[]);
+static bool do_pq_peek(int argc, char *argv[]);
+static bool do_pq_size(int argc, char *argv[]);
+static bool do_tw_new(int argc, char *argv[]);
+static bool do_tw_free(int argc, char *argv[]);
+static bool do_tw_add(int argc, char *argv[]);
+static bool do_tw_cancel(int argc, char *argv[]);
+static bool do_tw_tick(int argc, char *argv[]);
+static bool do_lru_new(int argc, char *argv[]);
+static bool do_lru_free(int argc, char *argv[]);
+static bool do_lru_put(int argc, char *argv[]);
+static bool do_lru_get(int argc, char *argv[]);
+static bool do_lru_remove(int argc, char *argv[]);
+static bool do_lru_show(int argc, char *argv[]);
+static bool do_lru_bench(int argc, char *argv[]);
+static bool do_small_bench(int argc, char *argv[]);
+static bool do_stress(int argc, char *argv[]);
+static bool do_typed_bench(int argc, char *argv[]);
+static bool do_locale(int argc, char *argv[]);
+static bool do_locale_bench(int argc, char *argv[]);
+static bool do_blob_bench(int argc, char *argv[]);
+static bool show_lru(int vlevel);
 
 static void queue_init();
+static void set_capacity(int oldval);
+static void set_policy(int oldval);
 
 static void console_init()
 {
@@ -96,16 +202,158 @@ static void console_init()
         "rhq", do_remove_head_quiet,
         "                | Remove from head of queue without reporting value.");
     add_cmd("reverse", do_reverse, "                | Reverse queue");
-    add_cmd("sort", do_sort, "                | Sort queue in ascending order");
+    add_cmd("shuffle", do_shuffle,
+            " [seed]         | Put queue in a random order, drawn from seed if "
+            "given");
+    add_cmd("sort", do_sort,
+            " [order]        | Sort queue in order asc, desc, nocase, "
+            "numeric, locale or collate (default: asc)");
+    add_cmd("sorted", do_sorted,
+            "                | Keep queue sorted: later insertions go to their "
+            "ordered position");
     add_cmd("size", do_size,
             " [n]            | Compute queue size n times (default: n == 1)");
     add_cmd("show", do_show, "                | Show queue contents");
+    add_cmd("index", do_index,
+            "                | Build hash index for lookup and removal by "
+            "value");
+    add_cmd("find", do_find,
+            " str [n]        | Look up string str in queue n times "
+            "(default: n == 1)");
+    add_cmd("bloom", do_bloom,
+            " [fp]           | Attach Bloom filter with false-positive rate fp "
+            "(default 0.01)");
+    add_cmd("contains", do_contains,
+            " str [n]        | Test n times whether queue holds str");
+    add_cmd("intern", do_intern,
+            "                | Share one copy of equal values and report "
+            "memory saved");
+    add_cmd("rv", do_remove_value,
+            " str            | Remove an element holding string str");
+    add_cmd("dedup", do_dedup,
+            " [last]         | Remove duplicate values, keeping the first (or "
+            "last) occurrence");
+    add_cmd("pos", do_positions,
+            "                | Build positional index for access by position");
+    add_cmd("at", do_at,
+            " i [n]          | Look up element at position i n times "
+            "(default: n == 1)");
+    add_cmd("delat", do_delete_at,
+            " i              | Delete element at position i");
+    add_cmd("rotate", do_rotate,
+            " k              | Move first k elements of queue behind the "
+            "others");
+    add_cmd("split", do_split,
+            " i              | Split queue at position i and delete the part "
+            "split off");
+    add_cmd("blobs", do_blobs,
+            " [min]          | Store values of min bytes or more in a blob "
+            "region (default 4096)");
+    add_cmd("freeze", do_freeze,
+            " [block]        | Convert queue to front-coded blocks of block "
+            "strings (default 16)");
+    add_cmd("thaw", do_thaw,
+            "                | Convert frozen queue back to a list");
+    add_cmd("frh", do_frozen_remove_head,
+            " [str]          | Remove from head of frozen queue.  Optionally "
+            "compare to expected value str");
+    add_cmd("snap", do_snap,
+            "                | Take snapshot of queue, replacing the old one");
+    add_cmd("snapcheck", do_snap_check,
+            "                | Check snapshot still holds the queue as taken");
+    add_cmd("snapfree", do_snap_free, "                | Delete snapshot");
+    add_cmd("bqbench", do_bq_bench,
+            " p c n [b] [m]  | Move n items from p producer to c consumer "
+            "threads through a blocking queue, b per batch (default: b == 1), "
+            "at most m queued");
+    add_cmd("lfbench", do_lf_bench,
+            " t n            | Insert and remove n items with 1 up to t "
+            "threads, lock-free and with a mutex");
+    add_cmd("spscbench", do_spsc_bench,
+            " n [b] [c]      | Move n items between two threads through a "
+            "ring of c slots, b at a time");
+    add_cmd("tlbench", do_tl_bench,
+            " p c n          | Move n items from p to c threads, with two "
+            "locks and with one");
+    add_cmd("wssort", do_ws_sort,
+            " t n            | Sort n strings on 1 and on t work-stealing "
+            "threads");
+    add_cmd("mqbench", do_mq_bench,
+            " t n [c]        | Insert and remove n items with 1 up to t "
+            "threads on c shards per thread");
+    add_cmd("bounds", do_bounds,
+            "                | Show capacity use and overflow counters");
+    add_cmd("pnew", do_pq_new, "                | Create new priority queue");
+    add_cmd("pfree", do_pq_free, "                | Delete priority queue");
+    add_cmd("pins", do_pq_insert,
+            " str [n]        | Insert string str into priority queue n times. "
+            "Generate random string(s) if str equals RAND. (default: n == 1)");
+    add_cmd("prm", do_pq_remove_min,
+            " [str]          | Remove smallest element from priority queue.  "
+            "Optionally compare to expected value str");
+    add_cmd("ppeek", do_pq_peek,
+            " [str]          | Show smallest element of priority queue.  "
+            "Optionally compare to expected value str");
+    add_cmd("psize", do_pq_size,
+            "                | Compute priority queue size");
+    add_cmd("wnew", do_tw_new, "                | Create new timing wheel");
+    add_cmd("wfree", do_tw_free, "                | Delete timing wheel");
+    add_cmd("wadd", do_tw_add,
+            " d str [n]      | Schedule string str n times, due in d ticks. "
+            "Draw random delays if d equals RAND. (default: n == 1)");
+    add_cmd("wcancel", do_tw_cancel,
+            " i [n]          | Cancel n timers from the i-th scheduled on "
+            "(default: n == 1)");
+    add_cmd("wtick", do_tw_tick,
+            " [t]            | Advance clock t ticks and collect what expires "
+            "(default: t == 1)");
+    add_cmd("lnew", do_lru_new,
+            " c [bytes]      | Create new LRU cache of c entries (or c bytes)");
+    add_cmd("lfree", do_lru_free, "                | Delete LRU cache");
+    add_cmd("lput", do_lru_put,
+            " key val        | Map key to val in LRU cache");
+    add_cmd("lget", do_lru_get,
+            " key [val]      | Look up key in LRU cache.  Optionally compare "
+            "to expected value val");
+    add_cmd("lrm", do_lru_remove,
+            " key            | Remove key from LRU cache");
+    add_cmd("lshow", do_lru_show, "                | Show LRU cache contents");
+    add_cmd("lrubench", do_lru_bench,
+            " n k c [s]      | Look up n Zipf-distributed keys out of k, with "
+            "exponent s, in an LRU cache of c entries (default: s == 0.99)");
+    add_cmd("smallbench", do_small_bench,
+            " n              | Time n cycles of new, insert x3 and free, with "
+            "inline and with spilled values");
+    add_cmd("stress", do_stress,
+            " pct [max]      | Fill a queue with as many elements as pct "
+            "percent of available memory holds (at most max), then check "
+            "its size");
+    add_cmd("tqbench", do_typed_bench,
+            " n              | Time insert, reverse, sort and remove of n "
+            "64-bit values in a typed queue and in a string queue");
+    add_cmd("locale", do_locale,
+            " [name]         | Show or set the locale used to collate strings");
+    add_cmd("localebench", do_locale_bench,
+            " n              | Time sorting n words in locale order by "
+            "collation keys and by strcoll");
+    add_cmd("blobbench", do_blob_bench,
+            " n [pct] [len]  | Time n values, pct% of them len bytes long, "
+            "stored on the heap and in a blob region (default 10% of 65536)");
     add_param("length", &string_length, "Maximum length of displayed string",
               NULL);
     add_param("malloc", &fail_probability, "Malloc failure probability percent",
               NULL);
     add_param("fail", &fail_limit,
               "Number of times allow queue operations to return false", NULL);
+    add_param("capacity", &capacity,
+              "Maximum number of elements (or bytes) in queue, 0 for no limit",
+              set_capacity);
+    add_param("capbytes", &capacity_bytes,
+              "Count capacity in bytes of strings rather than elements",
+              set_capacity);
+    add_param("policy", &policy,
+              "When full: 0 reject, 1 block, 2 drop oldest, 3 drop newest",
+              set_policy);
 }
 
 static bool do_new(int argc, char *argv[])
@@ -122,8 +370,10 @@ static bool do_new(int argc, char *argv[])
     }
     error_check();
 
-    if (exception_setup(true))
+    if (exception_setup(true)) {
         q = q_new();
+        q_set_capacity(q, capacity, capacity_bytes, policy);
+    }
     exception_cancel();
     qcnt = 0;
     show_queue(3);
@@ -131,6 +381,23 @@ static bool do_new(int argc, char *argv[])
     return ok && !error_check();
 }
 
+/* Unmap the blob region once no queue can hold its values any longer */
+static bool drop_blobs()
+{
+    if (!blobs)
+        return true;
+
+    bool ok = true;
+    if (blobs->count) {
+        report(1, "ERROR: Blob region still holds %lu values", blobs->count);
+        ok = false;
+    }
+    bl_free(blobs);
+    blobs = NULL;
+
+    return ok;
+}
+
 static bool do_free(int argc, char *argv[])
 {
     if (argc != 1) {
@@ -154,7 +421,12 @@ static bool do_free(int argc, char *argv[])
     qcnt = 0;
     show_queue(3);
 
-    size_t bcnt = allocation_check();
+    /* An orphaned queue keeps its values until its last snapshot goes */
+    if (!(snap && snap->source))
+        ok = drop_blobs() && ok;
+
+    /* Blocks of the other structures are still in use */
+    size_t bcnt = pq || snap || tw || lc || fz ? 0 : allocation_check();
     if (bcnt > 0) {
         report(1, "ERROR: Freed queue, but %lu blocks are still allocated",
                bcnt);
@@ -183,7 +455,7 @@ static bool do_insert_head(int argc, char *argv[])
 {
     char *lasts = NULL;
     char randstr_buf[MAX_RANDSTR_LEN];
-    int reps = 1;
+    long reps = 1;
     bool ok = true, need_rand = false;
     if (argc != 2 && argc != 3) {
         report(1, "%s needs 1-2 arguments", argv[0]);
@@ -192,7 +464,7 @@ static bool do_insert_head(int argc, char *argv[])
 
     char *inserts = argv[1];
     if (argc == 3) {
-        if (!get_int(argv[2], &reps)) {
+        if (!get_long(argv[2], &reps)) {
             report(1, "Invalid number of insertions '%s'", argv[2]);
             return false;
         }
@@ -208,21 +480,31 @@ static bool do_insert_head(int argc, char *argv[])
     error_check();
 
     if (exception_setup(true)) {
-        for (int r = 0; ok && r < reps; r++) {
+        for (long r = 0; ok && r < reps; r++) {
             if (need_rand)
                 fill_rand_string(randstr_buf, sizeof(randstr_buf));
+            long dropped = q ? q->dropped : 0;
+            long rejected = q ? q->rejected : 0;
             bool rval = q_insert_head(q, inserts);
-            if (rval) {
+            if (rval && q->dropped != dropped) {
+                /* A bounded queue shed this element or older ones */
+                qcnt = q->size;
+                lasts = NULL;
+            } else if (rval) {
                 qcnt++;
                 if (!q->head->value) {
                     report(1, "ERROR: Failed to save copy of string in list");
                     ok = false;
+                } else if (q_is_sorted(q)) {
+                    /* New element need not be at the head in sorted mode */
                 } else if (r == 0 && inserts == q->head->value) {
                     report(1,
                            "ERROR: Need to allocate and copy string for new "
                            "list element");
                     ok = false;
                     break;
+                } else if (q->pool) {
+                    /* Interned values are meant to share their string */
                 } else if (r == 1 && lasts == q->head->value) {
                     report(1,
                            "ERROR: Need to allocate separate string for each "
@@ -231,6 +513,14 @@ static bool do_insert_head(int argc, char *argv[])
                     break;
                 }
                 lasts = q->head->value;
+            } else if (q && q->rejected != rejected) {
+                /* Refused for want of room, as the policy says */
+                report(2, "Insertion of %s rejected by bounded queue", inserts);
+            } else if (q && q->dropped != dropped) {
+                report(1, "ERROR: Failed insertion of %s dropped %ld elements",
+                       inserts, q->dropped - dropped);
+                qcnt = q->size;
+                ok = false;
             } else {
                 fail_count++;
                 if (fail_count < fail_limit)
@@ -268,7 +558,7 @@ static bool do_insert_tail(int argc, char *argv[])
     }
 
     char randstr_buf[MAX_RANDSTR_LEN];
-    int reps = 1;
+    long reps = 1;
     bool ok = true, need_rand = false;
     if (argc != 2 && argc != 3) {
         report(1, "%s needs 1-2 arguments", argv[0]);
@@ -277,7 +567,7 @@ static bool do_insert_tail(int argc, char *argv[])
 
     char *inserts = argv[1];
     if (argc == 3) {
-        if (!get_int(argv[2], &reps)) {
+        if (!get_long(argv[2], &reps)) {
             report(1, "Invalid number of insertions '%s'", argv[2]);
             return false;
         }
@@ -293,16 +583,29 @@ static bool do_insert_tail(int argc, char *argv[])
     error_check();
 
     if (exception_setup(true)) {
-        for (int r = 0; ok && r < reps; r++) {
+        for (long r = 0; ok && r < reps; r++) {
             if (need_rand)
                 fill_rand_string(randstr_buf, sizeof(randstr_buf));
+            long dropped = q ? q->dropped : 0;
+            long rejected = q ? q->rejected : 0;
             bool rval = q_insert_tail(q, inserts);
-            if (rval) {
+            if (rval && q->dropped != dropped) {
+                /* A bounded queue shed this element or older ones */
+                qcnt = q->size;
+            } else if (rval) {
                 qcnt++;
                 if (!q->head->value) {
                     report(1, "ERROR: Failed to save copy of string in list");
                     ok = false;
                 }
+            } else if (q && q->rejected != rejected) {
+                /* Refused for want of room, as the policy says */
+                report(2, "Insertion of %s rejected by bounded queue", inserts);
+            } else if (q && q->dropped != dropped) {
+                report(1, "ERROR: Failed insertion of %s dropped %ld elements",
+                       inserts, q->dropped - dropped);
+                qcnt = q->size;
+                ok = false;
             } else {
                 fail_count++;
                 if (fail_count < fail_limit)
@@ -449,6 +752,23 @@ static bool do_remove_head_quiet(int argc, char *argv[])
     return ok && !error_check();
 }
 
+/* Ensure the backward links mirror the forward ones */
+static bool check_links()
+{
+    if (!q)
+        return true;
+
+    size_t cnt = 0;
+    for (list_ele_t *e = q->head; e && cnt < qcnt; e = e->next, cnt++) {
+        if (e->next ? e->next->prev != e : q->tail != e) {
+            report(1, "ERROR: Backward links do not match forward ones");
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static bool do_reverse(int argc, char *argv[])
 {
     if (argc != 1) {
@@ -460,14 +780,89 @@ static bool do_reverse(int argc, char *argv[])
         report(3, "Warning: Calling reverse on null queue");
     error_check();
 
-    set_noallocate_mode(true);
+    /* Live snapshots get a private copy before the queue is relinked */
+    set_noallocate_mode(!(snap && snap->source));
     if (exception_setup(true))
         q_reverse(q);
     exception_cancel();
 
     set_noallocate_mode(false);
+
+    bool ok = check_links();
+
     show_queue(3);
-    return !error_check();
+    return ok && !error_check();
+}
+
+/* Sum of the hashes of the values, which any order of them leaves alike */
+static uint64_t value_sum()
+{
+    uint64_t sum = 0;
+    size_t cnt = 0;
+    for (list_ele_t *e = q ? q->head : NULL; e && cnt < qcnt;
+         e = e->next, cnt++)
+        sum += hash_str64(e->value);
+
+    return sum;
+}
+
+static bool do_shuffle(int argc, char *argv[])
+{
+    if (argc != 1 && argc != 2) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    long seed = random();
+    if (argc == 2 && !get_long(argv[1], &seed)) {
+        report(1, "Invalid seed '%s'", argv[1]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling shuffle on null queue");
+    error_check();
+
+    /* Snapshots sharing the queue may take a copy, but nothing else stays */
+    bool shared = snap && snap->source;
+    uint64_t sum = value_sum();
+    size_t bcnt = allocation_check();
+    bool rval = false;
+    double start;
+    init_time(&start);
+    if (exception_setup(true))
+        rval = q_shuffle(q, (uint64_t) seed);
+    exception_cancel();
+    double elapsed = delta_time(&start);
+
+    bool ok = true;
+    if (!rval && q) {
+        fail_count++;
+        if (fail_count < fail_limit) {
+            report(2, "Shuffle failed");
+        } else {
+            report(1, "ERROR: Shuffle failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    } else if (rval) {
+        report(2, "Shuffled %lu elements in %.6f seconds", q_size(q),
+               elapsed);
+    }
+
+    if (!shared && allocation_check() != bcnt) {
+        report(1, "ERROR: Shuffle left %ld blocks of scratch memory allocated",
+               (long) (allocation_check() - bcnt));
+        ok = false;
+    }
+    if (ok && value_sum() != sum) {
+        report(1, "ERROR: Shuffle changed the values in queue");
+        ok = false;
+    }
+    ok = ok && check_links();
+
+    show_queue(3);
+    return ok && !error_check();
 }
 
 static bool do_size(int argc, char *argv[])
@@ -491,7 +886,7 @@ static bool do_size(int argc, char *argv[])
         return false;
     }
 
-    int reps = 1;
+    long reps = 1;
     bool ok = true;
     if (argc != 1 && argc != 2) {
         report(1, "%s needs 0-1 arguments", argv[0]);
@@ -499,18 +894,19 @@ static bool do_size(int argc, char *argv[])
     }
 
     if (argc == 2) {
-        if (!get_int(argv[1], &reps)) {
-            report(1, "Invalid number of calls to size '%s'", argv[2]);
+        if (!get_long(argv[1], &reps)) {
+            report(1, "Invalid number of calls to size '%s'", argv[1]);
+            return false;
         }
     }
 
-    int cnt = 0;
+    size_t cnt = 0;
     if (!q)
         report(3, "Warning: Calling size on null queue");
     error_check();
 
     if (exception_setup(true)) {
-        for (int r = 0; ok && r < reps; r++) {
+        for (long r = 0; ok && r < reps; r++) {
             cnt = q_size(q);
             ok = ok && !error_check();
         }
@@ -519,11 +915,12 @@ static bool do_size(int argc, char *argv[])
 
     if (ok) {
         if (qcnt == cnt) {
-            report(2, "Queue size = %d", cnt);
+            report(2, "Queue size = %lu", cnt);
         } else {
             report(1,
-                   "ERROR: Computed queue size as %d, but correct value is %d",
-                   cnt, (int) qcnt);
+                   "ERROR: Computed queue size as %lu, but correct value is "
+                   "%lu",
+                   cnt, qcnt);
             ok = false;
         }
     }
@@ -533,134 +930,2668 @@ static bool do_size(int argc, char *argv[])
     return ok && !error_check();
 }
 
+static char *order_names[] = {"asc",    "desc",   "nocase",
+                              "numeric", "locale", "collate"};
+
+/* Ensure each element in the given order */
+static bool check_order(q_order_t order)
+{
+    if (!q)
+        return true;
+
+    size_t cnt = q_size(q);
+    for (list_ele_t *e = q->head; e && --cnt; e = e->next) {
+        if (!q_before(order, e, e->next)) {
+            report(1, "ERROR: Not sorted in %s order", order_names[order]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool do_sort(int argc, char *argv[])
 {
-    if (argc != 1) {
-        report(1, "%s takes no arguments", argv[0]);
+    if (argc != 1 && argc != 2) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
         return false;
     }
 
+    q_order_t order = Q_ASC;
+    if (argc == 2) {
+        int n = sizeof(order_names) / sizeof(order_names[0]);
+        while (order < n && strcmp(argv[1], order_names[order]))
+            order++;
+        if (order == n) {
+            report(1, "Unknown order '%s'", argv[1]);
+            return false;
+        }
+    }
+
     if (!q)
         report(3, "Warning: Calling sort on null queue");
     error_check();
 
-    int cnt = q_size(q);
+    size_t cnt = q_size(q);
     if (cnt < 2)
         report(3, "Warning: Calling sort on single node");
     error_check();
 
-    set_noallocate_mode(true);
+    /*
+     * Live snapshots get a private copy before the queue is relinked.  The
+     * locale order may also allocate scratch memory, but must free it all.
+     */
+    bool shared = snap && snap->source;
+    size_t bcnt = allocation_check();
+    set_noallocate_mode(!shared && order != Q_LOCALE);
     if (exception_setup(true))
-        q_sort(q);
+        q_sort_by(q, order);
     exception_cancel();
     set_noallocate_mode(false);
 
     bool ok = true;
-    if (q) {
-        for (list_ele_t *e = q->head; e && --cnt; e = e->next) {
-            /* Ensure each element in ascending order */
-            /* FIXME: add an option to specify sorting order */
-            if (strcasecmp(e->value, e->next->value) > 0) {
-                report(1, "ERROR: Not sorted in ascending order");
-                ok = false;
-                break;
-            }
-        }
+    if (!shared && allocation_check() != bcnt) {
+        report(1, "ERROR: Sort left %ld blocks of scratch memory allocated",
+               (long) (allocation_check() - bcnt));
+        ok = false;
     }
+    ok = ok && check_order(order) && check_links();
 
     show_queue(3);
     return ok && !error_check();
 }
 
-static bool show_queue(int vlevel)
+static bool do_sorted(int argc, char *argv[])
 {
-    bool ok = true;
-    if (verblevel < vlevel)
-        return true;
-
-    int cnt = 0;
-    if (!q) {
-        report(vlevel, "q = NULL");
-        return true;
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
     }
 
-    report_noreturn(vlevel, "q = [");
-    list_ele_t *e = q->head;
-    if (exception_setup(true)) {
-        while (ok && e && cnt < qcnt) {
-            if (cnt < big_queue_size)
-                report_noreturn(vlevel, cnt == 0 ? "%s" : " %s", e->value);
-            e = e->next;
-            cnt++;
-            ok = ok && !error_check();
-        }
-    }
+    if (!q)
+        report(3, "Warning: Calling sorted on null queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_make_sorted(q);
     exception_cancel();
 
-    if (!ok) {
-        report(vlevel, " ... ]");
-        return false;
+    bool ok = true;
+    if (!rval) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Switching to sorted mode failed");
+        else {
+            report(1,
+                   "ERROR: Switching to sorted mode failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
     }
 
-    if (!e) {
-        if (cnt <= big_queue_size)
-            report(vlevel, "]");
-        else
-            report(vlevel, " ... ]");
-    } else {
-        report(vlevel, " ... ]");
-        report(
-            vlevel,
-            "ERROR:  Either list has cycle, or queue has more than %d elements",
-            qcnt);
-        ok = false;
-    }
+    ok = ok && check_order(Q_ASC);
 
-    return ok;
+    show_queue(3);
+    return ok && !error_check();
 }
 
-static bool do_show(int argc, char *argv[])
+static bool do_index(int argc, char *argv[])
 {
     if (argc != 1) {
         report(1, "%s takes no arguments", argv[0]);
         return false;
     }
-    return show_queue(0);
-}
 
-/* Signal handlers */
-static void sigsegvhandler(int sig)
-{
-    report(1,
-           "Segmentation fault occurred.  You dereferenced a NULL or invalid "
-           "pointer");
-    /* Raising a SIGABRT signal to produce a core dump for debugging. */
-    abort();
-}
+    if (!q)
+        report(3, "Warning: Calling index on null queue");
+    error_check();
 
-static void sigalrmhandler(int sig)
-{
-    trigger_exception(
-        "Time limit exceeded.  Either you are in an infinite loop, or your "
-        "code is too inefficient");
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_enable_index(q);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        size_t bytes = hi_memory(q->hidx);
+        report(2, "Index holds %lu distinct values in %lu slots, %lu bytes",
+               q->hidx->count, q->hidx->capacity, bytes);
+        /* Each element also carries the links of its sibling ring */
+        if (qcnt > 0)
+            report(2, "Index overhead = %.1f bytes per element",
+                   (double) bytes / qcnt + 2 * sizeof(list_ele_t *));
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Building index failed");
+        else {
+            report(1, "ERROR: Building index failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
 }
 
-static void queue_init()
+static bool do_find(int argc, char *argv[])
 {
-    fail_count = 0;
-    q = NULL;
-    signal(SIGSEGV, sigsegvhandler);
-    signal(SIGALRM, sigalrmhandler);
+    int reps = 1;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (argc == 3) {
+        if (!get_int(argv[2], &reps)) {
+            report(1, "Invalid number of lookups '%s'", argv[2]);
+            return false;
+        }
+    }
+
+    if (!q)
+        report(3, "Warning: Calling find on null queue");
+    error_check();
+
+    bool ok = true;
+    list_ele_t *e = NULL;
+    if (exception_setup(true)) {
+        for (int r = 0; ok && r < reps; r++) {
+            e = q_find(q, argv[1]);
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    if (ok) {
+        if (!e) {
+            report(2, "%s not found in queue", argv[1]);
+        } else if (strcmp(e->value, argv[1])) {
+            report(1, "ERROR: Looked up %s, but found %s", argv[1], e->value);
+            ok = false;
+        } else {
+            report(2, "Found %s in queue", argv[1]);
+        }
+    }
+
+    return ok && !error_check();
 }
 
-static bool queue_quit(int argc, char *argv[])
+static bool do_bloom(int argc, char *argv[])
 {
-    report(3, "Freeing queue");
-    if (qcnt > big_queue_size)
-        set_cautious_mode(false);
+    double fp_rate = 0.01;
+    if (argc == 2) {
+        char *end;
+        fp_rate = strtod(argv[1], &end);
+        if (*end || !(fp_rate > 0 && fp_rate < 1)) {
+            report(1, "Invalid false-positive rate '%s'", argv[1]);
+            return false;
+        }
+    } else if (argc != 1) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling bloom on null queue");
+    error_check();
 
+    bool rval = false;
     if (exception_setup(true))
-        q_free(q);
+        rval = q_enable_bloom(q, fp_rate);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        bloom_t *bf = q->bloom;
+        size_t bytes = bf_memory(bf);
+        report(2, "Bloom filter has %lu counters and %d hashes, %lu bytes",
+               bf->m, bf->k, bytes);
+        report(2, "Sized for %lu values, %.1f bits per value", bf->capacity,
+               8.0 * bytes / bf->capacity);
+        report(2, "Estimated false-positive rate = %.4f", bf_estimate_fp(bf));
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Building Bloom filter failed");
+        else {
+            report(1, "ERROR: Building Bloom filter failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_contains(int argc, char *argv[])
+{
+    int reps = 1;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (argc == 3) {
+        if (!get_int(argv[2], &reps)) {
+            report(1, "Invalid number of lookups '%s'", argv[2]);
+            return false;
+        }
+    }
+
+    if (!q)
+        report(3, "Warning: Calling contains on null queue");
+    error_check();
+
+    bool ok = true;
+    bool found = false;
+    if (exception_setup(true)) {
+        for (int r = 0; ok && r < reps; r++) {
+            found = q_contains(q, argv[1]);
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    /* Check the answer against a plain scan */
+    bool present = false;
+    for (list_ele_t *e = q ? q->head : NULL; e && !present; e = e->next)
+        present = !strcmp(e->value, argv[1]);
+
+    if (ok) {
+        if (found != present) {
+            report(1, "ERROR: Queue %s %s, but contains returned %s",
+                   present ? "holds" : "does not hold", argv[1],
+                   found ? "true" : "false");
+            ok = false;
+        } else {
+            report(2, "%s %s in queue", argv[1], found ? "is" : "is not");
+        }
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_intern(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling intern on null queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_enable_interning(q);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        intern_t *pool = q->pool;
+        report(2, "Pool holds %lu distinct values in %lu bytes", pool->count,
+               in_memory(pool));
+        report(2, "Sharing saves %lu bytes of string copies", pool->saved);
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Interning failed");
+        else {
+            report(1, "ERROR: Interning failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+static bool do_remove_value(int argc, char *argv[])
+{
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling remove value on null queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_remove_value(q, argv[1]);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Removed %s from queue", argv[1]);
+        qcnt--;
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Removal of %s failed", argv[1]);
+        else {
+            report(1, "ERROR: Removal of %s failed (%d failures total)",
+                   argv[1], fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+/* A value of the queue together with its position, used to check dedup */
+typedef struct {
+    char *value;
+    size_t pos;
+} occurrence_t;
+
+static int cmp_occurrence(const void *a, const void *b)
+{
+    const occurrence_t *x = a, *y = b;
+    int c = strcmp(x->value, y->value);
+    if (c)
+        return c;
+    return x->pos < y->pos ? -1 : x->pos > y->pos;
+}
+
+/*
+ * Work out which values should survive dedup, in queue order.
+ * Return NULL if could not allocate space.
+ */
+static char **expected_dedup(bool keep_first, size_t *kept)
+{
+    occurrence_t *occ = malloc((qcnt + 1) * sizeof(occurrence_t));
+    char **vals = malloc((qcnt + 1) * sizeof(char *));
+    bool *keep = calloc(qcnt + 1, sizeof(bool));
+    if (!occ || !vals || !keep) {
+        free(occ);
+        free(vals);
+        free(keep);
+        return NULL;
+    }
+
+    size_t cnt = 0;
+    for (list_ele_t *e = q->head; e && cnt < qcnt; e = e->next, cnt++) {
+        occ[cnt].value = e->value;
+        occ[cnt].pos = cnt;
+        vals[cnt] = e->value;
+    }
+    qsort(occ, cnt, sizeof(occurrence_t), cmp_occurrence);
+
+    /* Equal values are adjacent and ordered by position */
+    for (size_t i = 0; i < cnt; i++) {
+        bool first = i == 0 || strcmp(occ[i - 1].value, occ[i].value);
+        bool last = i + 1 == cnt || strcmp(occ[i].value, occ[i + 1].value);
+        if (keep_first ? first : last)
+            keep[occ[i].pos] = true;
+    }
+
+    *kept = 0;
+    for (size_t i = 0; i < cnt; i++) {
+        if (keep[i])
+            vals[(*kept)++] = vals[i];
+    }
+
+    free(occ);
+    free(keep);
+    return vals;
+}
+
+static bool do_dedup(int argc, char *argv[])
+{
+    bool keep_first = true;
+    if (argc == 2 && !strcmp(argv[1], "last")) {
+        keep_first = false;
+    } else if (argc != 1) {
+        report(1, "%s takes 0-1 arguments: [last]", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling dedup on null queue");
+    error_check();
+
+    size_t kept = 0;
+    char **expected = NULL;
+    if (q) {
+        expected = expected_dedup(keep_first, &kept);
+        if (!expected) {
+            report(1, "ERROR: Could not allocate space to check dedup");
+            return false;
+        }
+    }
+
+    /* Dropping many elements would make cautious mode scan quadratically */
+    if (qcnt > big_queue_size)
+        set_cautious_mode(false);
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_dedup(q, keep_first);
+    exception_cancel();
+    set_cautious_mode(true);
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Removed %lu duplicates", qcnt - kept);
+        qcnt = kept;
+
+        size_t cnt = 0;
+        list_ele_t *e = q->head;
+        for (; e && cnt < kept; e = e->next, cnt++) {
+            if (e->value != expected[cnt]) {
+                report(1, "ERROR: Element %lu holds %s, expected %s", cnt,
+                       e->value, expected[cnt]);
+                ok = false;
+                break;
+            }
+        }
+        if (ok && (e || cnt != kept || q_size(q) != kept)) {
+            report(1, "ERROR: Expected %lu elements after dedup", kept);
+            ok = false;
+        }
+        ok = ok && check_links();
+    } else if (q) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Dedup failed");
+        else {
+            report(1, "ERROR: Dedup failed (%d failures total)", fail_count);
+            ok = false;
+        }
+    }
+    free(expected);
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+/* Largest queue whose positional index gets checked entry by entry */
+#define POS_CHECK_MAX 100000
+
+/* Walk cnt elements into pq, the way the positional index must not */
+static list_ele_t *walk_to(queue_t *pq, size_t cnt)
+{
+    list_ele_t *e = pq->head;
+    while (e && cnt--)
+        e = e->next;
+
+    return e;
+}
+
+/* Ensure an up-to-date positional index of pq agrees with its chain */
+static bool check_positions(queue_t *pq, size_t cnt)
+{
+    if (!pq || !pq->pos || pq->pos->stale || cnt > POS_CHECK_MAX)
+        return true;
+
+    size_t i = 0, bytes = 0;
+    for (list_ele_t *e = pq->head; e && i < cnt; e = e->next, i++) {
+        size_t before;
+        if (pi_at(pq->pos, pq->head, i, &before) != e || before != bytes) {
+            report(1, "ERROR: Positional index is wrong at position %lu", i);
+            return false;
+        }
+        bytes += strlen(e->value) + 1;
+    }
+    if (bytes != pq->bytes) {
+        report(1, "ERROR: Queue holds %lu bytes, expected %lu", pq->bytes,
+               bytes);
+        return false;
+    }
+
+    return true;
+}
+
+/* Parse a position, which get_long would let go negative */
+static bool get_position(char *arg, size_t *loc)
+{
+    long val;
+    if (!get_long(arg, &val) || val < 0) {
+        report(1, "Invalid position '%s'", arg);
+        return false;
+    }
+
+    *loc = val;
+    return true;
+}
+
+static bool do_positions(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling pos on null queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_enable_positions(q);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Positional index over %lu elements", q_size(q));
+        ok = check_positions(q, qcnt);
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Building positional index failed");
+        else {
+            report(1,
+                   "ERROR: Building positional index failed (%d failures "
+                   "total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+static bool do_at(int argc, char *argv[])
+{
+    long reps = 1;
+    size_t i;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_position(argv[1], &i))
+        return false;
+    if (argc == 3 && !get_long(argv[2], &reps)) {
+        report(1, "Invalid number of lookups '%s'", argv[2]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling at on null queue");
+    error_check();
+
+    /* Rebuilding a stale index may allocate, and the index keeps it */
+    bool ok = true;
+    list_ele_t *e = NULL;
+    double start;
+    init_time(&start);
+    if (exception_setup(true)) {
+        for (long r = 0; ok && r < reps; r++) {
+            e = q_at(q, i);
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+    double elapsed = delta_time(&start);
+
+    if (ok) {
+        list_ele_t *expected = q ? walk_to(q, i) : NULL;
+        if (e != expected) {
+            report(1, "ERROR: Looked up position %lu, but found %s", i,
+                   e ? e->value : "nothing");
+            ok = false;
+        } else if (!e) {
+            report(2, "No element at position %lu", i);
+        } else {
+            report(2, "Found %s at position %lu in %.6f seconds", e->value, i,
+                   elapsed);
+        }
+    }
+    ok = ok && check_positions(q, qcnt);
+
+    return ok && !error_check();
+}
+
+static bool do_delete_at(int argc, char *argv[])
+{
+    size_t i;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_position(argv[1], &i))
+        return false;
+
+    if (!q)
+        report(3, "Warning: Calling delete at on null queue");
+    error_check();
+
+    /* The element after the deleted one must take its position */
+    list_ele_t *next = q ? walk_to(q, i + 1) : NULL;
+    bool rval = false;
+    if (exception_setup(true))
+        rval = q_delete_at(q, i);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Deleted element at position %lu", i);
+        qcnt--;
+        if (walk_to(q, i) != next) {
+            report(1, "ERROR: Wrong element deleted at position %lu", i);
+            ok = false;
+        }
+        ok = ok && check_links() && check_positions(q, qcnt);
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Deletion at position %lu failed", i);
+        else {
+            report(1, "ERROR: Deletion at position %lu failed (%d failures "
+                      "total)",
+                   i, fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+static bool do_rotate(int argc, char *argv[])
+{
+    size_t k;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_position(argv[1], &k))
+        return false;
+
+    if (!q)
+        report(3, "Warning: Calling rotate on null queue");
+    error_check();
+
+    list_ele_t *first = q && qcnt ? walk_to(q, k % qcnt) : NULL;
+    uint64_t sum = value_sum();
+    bool rval = false;
+    double start;
+    init_time(&start);
+    if (exception_setup(true))
+        rval = q_rotate(q, k);
+    exception_cancel();
+    double elapsed = delta_time(&start);
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Rotated %lu elements in %.6f seconds", q_size(q), elapsed);
+        if (q->head != first) {
+            report(1, "ERROR: Rotation by %lu left %s at head", k,
+                   q->head ? q->head->value : "nothing");
+            ok = false;
+        } else if (value_sum() != sum) {
+            report(1, "ERROR: Rotation changed the values in queue");
+            ok = false;
+        }
+        ok = ok && check_links() && check_positions(q, qcnt);
+    } else if (q) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Rotation failed");
+        else {
+            report(1, "ERROR: Rotation failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+static bool do_split(int argc, char *argv[])
+{
+    size_t i;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_position(argv[1], &i))
+        return false;
+
+    if (!q)
+        report(3, "Warning: Calling split on null queue");
+    error_check();
+
+    list_ele_t *first = q ? walk_to(q, i) : NULL;
+    queue_t *tail = NULL;
+    double start;
+    init_time(&start);
+    if (exception_setup(true))
+        tail = q_split(q, i);
+    exception_cancel();
+    double elapsed = delta_time(&start);
+
+    bool ok = true;
+    if (tail) {
+        report(2, "Split off %lu elements in %.6f seconds", q_size(tail),
+               elapsed);
+        if (q_size(q) != i || q_size(tail) != qcnt - i ||
+            tail->head != first || (q->tail && q->tail->next)) {
+            report(1, "ERROR: Split at position %lu cut queue wrongly", i);
+            ok = false;
+        }
+        if (ok && q->pos && !tail->pos) {
+            report(1, "ERROR: Part split off lost the positional index");
+            ok = false;
+        }
+        ok = ok && check_positions(tail, qcnt - i);
+        size_t tcnt = qcnt - i;
+        qcnt = i;
+        ok = ok && check_links() && check_positions(q, qcnt);
+
+        /* The part split off is only checked, so it goes right away */
+        if (tcnt > big_queue_size)
+            set_cautious_mode(false);
+        if (exception_setup(true))
+            q_free(tail);
+        exception_cancel();
+        set_cautious_mode(true);
+    } else if (q) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Split failed");
+        else {
+            report(1, "ERROR: Split failed (%d failures total)", fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+/* Values this long, terminator included, go to the blob region by default */
+#define BLOB_MIN 4096
+
+static bool do_blobs(int argc, char *argv[])
+{
+    int threshold = BLOB_MIN;
+    if (argc == 2) {
+        if (!get_int(argv[1], &threshold) || threshold < 1) {
+            report(1, "Invalid value length '%s'", argv[1]);
+            return false;
+        }
+    } else if (argc != 1) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling blobs on null queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true)) {
+        if (!blobs)
+            blobs = bl_new();
+        rval = blobs && q_use_blobs(q, blobs, threshold);
+    }
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Values of %d bytes or more go to the blob region",
+               threshold);
+        report(2, "Region holds %lu values, %lu bytes in %lu bytes of slots",
+               blobs->count, blobs->bytes, blobs->slotted);
+    } else {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Using blob region failed");
+        else {
+            report(1, "ERROR: Using blob region failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+/* Ensure reading fz from its head gives the cnt strings of pq in order */
+static bool check_frozen(queue_t *pq, size_t cnt)
+{
+    /* The check itself must not see malloc fail */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    fz_iter_t it;
+    bool init = fz_iter_init(&it, fz);
+    fail_probability = saved_fail_probability;
+    if (!init) {
+        report(1, "ERROR: Could not allocate space to read frozen queue");
+        return false;
+    }
+
+    bool ok = fz->size == cnt;
+    size_t i = 0;
+    list_ele_t *e = pq->head;
+    for (const char *s; ok && (s = fz_iter_next(&it)); e = e->next, i++)
+        ok = i < cnt && e && !strcmp(s, e->value);
+    ok = ok && i == cnt;
+    fz_iter_done(&it);
+
+    if (!ok)
+        report(1, "ERROR: Frozen queue differs from list at position %lu", i);
+    return ok;
+}
+
+static bool do_freeze(int argc, char *argv[])
+{
+    int block = FZ_BLOCK;
+    if (argc == 2) {
+        if (!get_int(argv[1], &block) || block < 1) {
+            report(1, "Invalid block size '%s'", argv[1]);
+            return false;
+        }
+    } else if (argc != 1) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (!q)
+        report(3, "Warning: Calling freeze on null queue");
+    error_check();
+
+    if (qcnt > big_queue_size || (fz && fz->size > big_queue_size))
+        set_cautious_mode(false);
+    /* A frozen queue from before stays unless this one replaces it */
+    frozen_t *frozen = NULL;
+    if (exception_setup(true)) {
+        frozen = fz_freeze(q, block);
+        if (frozen)
+            fz_free(fz);
+    }
+    exception_cancel();
+    set_cautious_mode(true);
+
+    bool ok = true;
+    if (frozen) {
+        fz = frozen;
+        ok = check_frozen(q, qcnt);
+        report(2,
+               "Froze %lu strings into %lu blocks: %lu bytes coded in %lu, "
+               "ratio %.2f",
+               fz->size, fz->nblocks, fz->bytes, fz->encoded,
+               fz->encoded ? (double) fz->bytes / fz->encoded : 0.0);
+        report(2, "Frozen queue takes %lu bytes against %lu as a list",
+               fz_memory(fz), qcnt * sizeof(list_ele_t) + q->bytes);
+
+        /* The list is of no further use */
+        ok = do_free(1, argv) && ok;
+    } else if (q) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Freezing failed");
+        else {
+            report(1, "ERROR: Freezing failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_thaw(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (!fz)
+        report(3, "Warning: Calling thaw on null frozen queue");
+    else if (q) {
+        report(3, "Freeing old queue");
+        ok = do_free(argc, argv);
+    }
+    error_check();
+
+    if (fz && fz->size > big_queue_size)
+        set_cautious_mode(false);
+    queue_t *thawed = NULL;
+    if (exception_setup(true))
+        thawed = fz_thaw(fz);
+    exception_cancel();
+
+    if (thawed) {
+        size_t cnt = fz->size;
+        ok = check_frozen(thawed, cnt) && ok;
+        if (exception_setup(true)) {
+            q_set_capacity(thawed, capacity, capacity_bytes, policy);
+            fz_free(fz);
+        }
+        exception_cancel();
+        fz = NULL;
+        q = thawed;
+        qcnt = cnt;
+        report(2, "Thawed %lu strings", qcnt);
+        ok = ok && check_links();
+    } else if (fz) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Thawing failed");
+        else {
+            report(1, "ERROR: Thawing failed (%d failures total)", fail_count);
+            ok = false;
+        }
+    }
+    set_cautious_mode(true);
+
+    show_queue(3);
+    return ok && !error_check();
+}
+
+static bool do_frozen_remove_head(int argc, char *argv[])
+{
+    if (argc != 1 && argc != 2) {
+        report(1, "%s needs 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    char *removes = malloc(string_length + 1);
+    if (!removes) {
+        report(1,
+               "INTERNAL ERROR.  Could not allocate space for removed strings");
+        return false;
+    }
+    removes[0] = '\0';
+
+    if (!fz)
+        report(3, "Warning: Calling remove head on null frozen queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = fz_remove_head(fz, removes, string_length + 1);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Removed %s from frozen queue", removes);
+    } else {
+        fail_count++;
+        if (argc == 1 && fail_count < fail_limit) {
+            report(2, "Removal from frozen queue failed");
+        } else {
+            report(1,
+                   "ERROR: Removal from frozen queue failed (%d failures "
+                   "total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    if (ok && argc == 2 && strcmp(removes, argv[1])) {
+        report(1, "ERROR: Removed value %s != expected value %s", removes,
+               argv[1]);
+        ok = false;
+    }
+
+    free(removes);
+    return ok && !error_check();
+}
+
+/* Most threads a workload may start on each side */
+#define MAX_THREADS 64
+
+/* Parse the thread counts of a workload, which must lie in [1, MAX_THREADS] */
+static bool get_threads(char *name, char *arg, int *loc)
+{
+    if (!get_int(arg, loc) || *loc < 1 || *loc > MAX_THREADS) {
+        report(1, "Invalid number of %s '%s'", name, arg);
+        return false;
+    }
+
+    return true;
+}
+
+static bool report_bench(char *name, bench_result_t *res)
+{
+    report(2, "%s: %ld items in %.3f seconds, %.2f M items/s", name,
+           res->items, res->seconds, res->items / res->seconds / 1e6);
+    report(2, "Hand-off latency: mean %.1f us, max %.1f us", res->avg_latency,
+           res->max_latency);
+    if (!res->ok) {
+        report(1, "ERROR: Items were lost or delivered more than once");
+        return false;
+    }
+
+    return true;
+}
+
+static bool do_bq_bench(int argc, char *argv[])
+{
+    int producers, consumers, n, batch = 1, bound = 0;
+    if (argc < 4 || argc > 6) {
+        report(1, "%s needs 3-5 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_threads("producers", argv[1], &producers) ||
+        !get_threads("consumers", argv[2], &consumers))
+        return false;
+    if (!get_int(argv[3], &n) || n < 1) {
+        report(1, "Invalid number of items '%s'", argv[3]);
+        return false;
+    }
+    if (argc > 4 && (!get_int(argv[4], &batch) || batch < 1)) {
+        report(1, "Invalid batch size '%s'", argv[4]);
+        return false;
+    }
+    if (argc > 5 && (!get_int(argv[5], &bound) || bound < 1)) {
+        report(1, "Invalid capacity '%s'", argv[5]);
+        return false;
+    }
+
+    /*
+     * Producers retry failed insertions, and threads must not be left
+     * running by the time limit, so the workload runs without either.
+     * Cautious frees would also scan every item still queued.
+     */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    bench_result_t res;
+    bool ok = bench_bqueue(producers, consumers, n, batch, bound, &res);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Could not start the threads");
+        return false;
+    }
+
+    return report_bench("Blocking queue", &res) && !error_check();
+}
+
+static bool do_lf_bench(int argc, char *argv[])
+{
+    int threads, n;
+    if (argc != 3) {
+        report(1, "%s needs 2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_threads("threads", argv[1], &threads))
+        return false;
+    if (!get_int(argv[2], &n) || n < 1) {
+        report(1, "Invalid number of items '%s'", argv[2]);
+        return false;
+    }
+
+    /* As for bqbench */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+
+    bool ok = true;
+    report(2, "Threads  Lock-free (M ops/s)  Mutex (M ops/s)");
+    for (int t = 1; ok; t = t * 2 < threads ? t * 2 : threads) {
+        bench_result_t lockfree, locked;
+        if (!bench_lfqueue(t, n, &lockfree, &locked)) {
+            report(1, "ERROR: Could not start the threads");
+            ok = false;
+            break;
+        }
+
+        /* Each item is inserted once and removed once */
+        report(2, "%7d  %19.2f  %15.2f", t,
+               2 * lockfree.items / lockfree.seconds / 1e6,
+               2 * locked.items / locked.seconds / 1e6);
+        if (!lockfree.ok || !locked.ok) {
+            report(1, "ERROR: Items were lost or delivered more than once");
+            ok = false;
+        }
+        if (t == threads)
+            break;
+    }
+
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    return ok && !error_check();
+}
+
+static bool do_spsc_bench(int argc, char *argv[])
+{
+    int n, batch = 1, capacity = 1024;
+    if (argc < 2 || argc > 4) {
+        report(1, "%s needs 1-3 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of items '%s'", argv[1]);
+        return false;
+    }
+    if (argc > 2 && (!get_int(argv[2], &batch) || batch < 1)) {
+        report(1, "Invalid batch size '%s'", argv[2]);
+        return false;
+    }
+    if (argc > 3 && (!get_int(argv[3], &capacity) || capacity < 1)) {
+        report(1, "Invalid capacity '%s'", argv[3]);
+        return false;
+    }
+
+    /* As for bqbench */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+
+    bench_result_t pointers, strings;
+    bool started = bench_spsc(n, capacity, batch, false, &pointers) &&
+                   bench_spsc(n, capacity, 1, true, &strings);
+
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!started) {
+        report(1, "ERROR: Could not start the threads");
+        return false;
+    }
+
+    bool ok = report_bench("Ring, by pointer", &pointers);
+    ok = report_bench("Ring, copying strings", &strings) && ok;
+
+    return ok && !error_check();
+}
+
+static bool do_tl_bench(int argc, char *argv[])
+{
+    int producers, consumers, n;
+    if (argc != 4) {
+        report(1, "%s needs 3 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_threads("producers", argv[1], &producers) ||
+        !get_threads("consumers", argv[2], &consumers))
+        return false;
+    if (!get_int(argv[3], &n) || n < 1) {
+        report(1, "Invalid number of items '%s'", argv[3]);
+        return false;
+    }
+
+    /* As for bqbench */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+
+    bench_result_t two_lock, one_lock;
+    bool started =
+        bench_tlqueue(producers, consumers, n, &two_lock, &one_lock);
+
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!started) {
+        report(1, "ERROR: Could not start the threads");
+        return false;
+    }
+
+    bool ok = report_bench("Two-lock queue", &two_lock);
+    ok = report_bench("Single-lock queue", &one_lock) && ok;
+
+    return ok && !error_check();
+}
+
+static bool do_ws_sort(int argc, char *argv[])
+{
+    int threads, n;
+    if (argc != 3) {
+        report(1, "%s needs 2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_threads("threads", argv[1], &threads))
+        return false;
+    if (!get_int(argv[2], &n) || n < 1) {
+        report(1, "Invalid number of strings '%s'", argv[2]);
+        return false;
+    }
+
+    /* As for bqbench */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+
+    bench_result_t single, pool;
+    long executed[MAX_THREADS], stolen[MAX_THREADS];
+    bool started = bench_wssort(1, n, &single, executed, stolen) &&
+                   bench_wssort(threads, n, &pool, executed, stolen);
+
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!started) {
+        report(1, "ERROR: Could not start the threads");
+        return false;
+    }
+
+    report(2, "1 thread: %.3f seconds, %d threads: %.3f seconds",
+           single.seconds, threads, pool.seconds);
+    report(2, "Worker  Tasks run  Tasks stolen");
+    for (int i = 0; i < threads; i++)
+        report(2, "%6d  %9ld  %12ld", i, executed[i], stolen[i]);
+    if (!single.ok || !pool.ok) {
+        report(1, "ERROR: Strings were not sorted");
+        return false;
+    }
+
+    return !error_check();
+}
+
+static bool do_mq_bench(int argc, char *argv[])
+{
+    int threads, n, per_thread = 2;
+    if (argc != 3 && argc != 4) {
+        report(1, "%s needs 2-3 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_threads("threads", argv[1], &threads))
+        return false;
+    if (!get_int(argv[2], &n) || n < 1) {
+        report(1, "Invalid number of items '%s'", argv[2]);
+        return false;
+    }
+    if (argc == 4 && (!get_int(argv[3], &per_thread) || per_thread < 1 ||
+                      per_thread > MAX_THREADS)) {
+        report(1, "Invalid number of shards per thread '%s'", argv[3]);
+        return false;
+    }
+
+    /* As for bqbench */
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+
+    bool ok = true;
+    report(2,
+           "Threads  Sharded (M ops/s)  Single lock (M ops/s)  "
+           "Rank error (mean, max)");
+    for (int t = 1; ok; t = t * 2 < threads ? t * 2 : threads) {
+        bench_result_t sharded, locked;
+        double mean_rank;
+        long max_rank;
+        if (!bench_mqueue(t, t * per_thread, n, &sharded, &locked,
+                          &mean_rank, &max_rank)) {
+            report(1, "ERROR: Could not start the threads");
+            ok = false;
+            break;
+        }
+
+        /* Each item is inserted once and removed once */
+        report(2, "%7d  %17.2f  %21.2f  %10.1f, %ld", t,
+               2 * sharded.items / sharded.seconds / 1e6,
+               2 * locked.items / locked.seconds / 1e6, mean_rank, max_rank);
+        if (!sharded.ok || !locked.ok) {
+            report(1, "ERROR: Items were lost or delivered more than once");
+            ok = false;
+        }
+        if (t == threads)
+            break;
+    }
+
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    return ok && !error_check();
+}
+
+/* Fingerprint of size values from head, telling apart order and contents */
+static uint64_t fingerprint(list_ele_t *head, size_t size)
+{
+    uint64_t sum = 0;
+    list_ele_t *e = head;
+    for (size_t i = 0; i < size && e; i++, e = e->next)
+        sum = (sum ^ hash_str64(e->value)) * 1099511628211ULL;
+
+    return sum;
+}
+
+static bool do_snap_free(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (!snap)
+        report(3, "Warning: Calling free on null snapshot");
+    error_check();
+
+    if (snapcnt > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true))
+        q_snapshot_free(snap);
+    exception_cancel();
+    set_cautious_mode(true);
+
+    snap = NULL;
+    snapcnt = 0;
+    if (!q)
+        ok = drop_blobs() && ok;
+
+    /* Blocks of the other structures are still in use */
+    size_t bcnt = q || pq || tw || lc || fz ? 0 : allocation_check();
+    if (bcnt > 0) {
+        report(1, "ERROR: Freed snapshot, but %lu blocks are still allocated",
+               bcnt);
+        ok = false;
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_snap(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (snap) {
+        report(3, "Freeing old snapshot");
+        ok = do_snap_free(argc, argv);
+    }
+
+    if (!q)
+        report(3, "Warning: Calling snap on null queue");
+    error_check();
+
+    double start;
+    init_time(&start);
+    if (exception_setup(true))
+        snap = q_snapshot(q);
+    exception_cancel();
+    double elapsed = delta_time(&start);
+
+    if (snap) {
+        snapcnt = qcnt;
+        snap_sum = fingerprint(q->head, qcnt);
+        report(2, "Snapshot of %lu elements taken in %.6f seconds", snapcnt,
+               elapsed);
+    } else if (q) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Snapshot failed");
+        else {
+            report(1, "ERROR: Snapshot failed (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_snap_check(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    if (!snap) {
+        report(3, "Warning: Calling snapcheck on null snapshot");
+        return !error_check();
+    }
+
+    bool ok = true;
+    if (snap->lost) {
+        /* Only allowed when the private copy ran out of memory */
+        report(2, "Snapshot was lost");
+        fail_count++;
+        if (fail_count >= fail_limit) {
+            report(1, "ERROR: Snapshot was lost (%d failures total)",
+                   fail_count);
+            ok = false;
+        }
+    } else if (snap->size != snapcnt) {
+        report(1, "ERROR: Snapshot holds %lu elements, expected %lu",
+               snap->size, snapcnt);
+        ok = false;
+    } else if (fingerprint(snap->head, snap->size) != snap_sum) {
+        report(1, "ERROR: Snapshot no longer holds the queue as taken");
+        ok = false;
+    } else {
+        report(2, "Snapshot of %lu elements %s", snapcnt,
+               snap->copy ? "copied" : "shared");
+    }
+
+    return ok && !error_check();
+}
+
+static bool show_pqueue(int vlevel)
+{
+    if (verblevel < vlevel)
+        return true;
+
+    if (!pq)
+        report(vlevel, "pq = NULL");
+    else if (pq_size(pq) == 0)
+        report(vlevel, "pq = []");
+    else
+        report(vlevel, "pq = [%s ... ] (%lu elements)", pq_peek_min(pq),
+               pq_size(pq));
+
+    return true;
+}
+
+static bool do_pq_new(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (pq) {
+        report(3, "Freeing old priority queue");
+        ok = do_pq_free(argc, argv);
+    }
+    error_check();
+
+    if (exception_setup(true))
+        pq = pq_new();
+    exception_cancel();
+    pqcnt = 0;
+    show_pqueue(3);
+
+    return ok && !error_check();
+}
+
+static bool do_pq_free(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (!pq)
+        report(3, "Warning: Calling free on null priority queue");
+    error_check();
+
+    if (pqcnt > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true))
+        pq_free(pq);
+    exception_cancel();
+    set_cautious_mode(true);
+
+    pq = NULL;
+    pqcnt = 0;
+    show_pqueue(3);
+
+    /* Blocks of the other structures are still in use */
+    size_t bcnt = q || snap || tw || lc || fz ? 0 : allocation_check();
+    if (bcnt > 0) {
+        report(1,
+               "ERROR: Freed priority queue, but %lu blocks are still "
+               "allocated",
+               bcnt);
+        ok = false;
+    }
+
+    return ok && !error_check();
+}
+
+static bool check_pq_log(bool (*is_log)(void))
+{
+    /* Cautious frees would scan every block of the big heap */
+    set_cautious_mode(false);
+    bool ok = is_log();
+    set_cautious_mode(true);
+    if (!ok) {
+        report(1, "ERROR: Probably not logarithmic time");
+        return false;
+    }
+    report(1, "Probably logarithmic time");
+    return ok;
+}
+
+static bool do_pq_insert(int argc, char *argv[])
+{
+    if (simulation) {
+        if (argc != 1) {
+            report(1, "%s does not need arguments in simulation mode", argv[0]);
+            return false;
+        }
+        return check_pq_log(is_pq_insert_log);
+    }
+
+    char randstr_buf[MAX_RANDSTR_LEN];
+    int reps = 1;
+    bool ok = true, need_rand = false;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    char *inserts = argv[1];
+    if (argc == 3) {
+        if (!get_int(argv[2], &reps)) {
+            report(1, "Invalid number of insertions '%s'", argv[2]);
+            return false;
+        }
+    }
+
+    if (!strcmp(inserts, "RAND")) {
+        need_rand = true;
+        inserts = randstr_buf;
+    }
+
+    if (!pq)
+        report(3, "Warning: Calling insert on null priority queue");
+    error_check();
+
+    if (exception_setup(true)) {
+        for (int r = 0; ok && r < reps; r++) {
+            if (need_rand)
+                fill_rand_string(randstr_buf, sizeof(randstr_buf));
+            if (pq_insert(pq, inserts)) {
+                pqcnt++;
+            } else {
+                fail_count++;
+                if (fail_count < fail_limit)
+                    report(2, "Insertion of %s failed", inserts);
+                else {
+                    report(1,
+                           "ERROR: Insertion of %s failed (%d failures total)",
+                           inserts, fail_count);
+                    ok = false;
+                }
+            }
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    show_pqueue(3);
+    return ok;
+}
+
+static bool do_pq_remove_min(int argc, char *argv[])
+{
+    if (simulation) {
+        if (argc != 1) {
+            report(1, "%s does not need arguments in simulation mode", argv[0]);
+            return false;
+        }
+        return check_pq_log(is_pq_remove_min_log);
+    }
+
+    if (argc != 1 && argc != 2) {
+        report(1, "%s needs 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    char *removes = malloc(string_length + 1);
+    if (!removes) {
+        report(1,
+               "INTERNAL ERROR.  Could not allocate space for removed strings");
+        return false;
+    }
+    removes[0] = '\0';
+
+    if (!pq)
+        report(3, "Warning: Calling remove min on null priority queue");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = pq_remove_min(pq, removes, string_length + 1);
+    exception_cancel();
+
+    bool ok = true;
+    if (rval) {
+        report(2, "Removed %s from priority queue", removes);
+        pqcnt--;
+        /* Whatever is left must not be smaller than what was removed */
+        char *next = pq_peek_min(pq);
+        if (next && strcmp(next, removes) < 0) {
+            report(1, "ERROR: Removed %s, but %s is smaller", removes, next);
+            ok = false;
+        }
+    } else {
+        fail_count++;
+        if (argc == 1 && fail_count < fail_limit) {
+            report(2, "Removal from priority queue failed");
+        } else {
+            report(1,
+                   "ERROR: Removal from priority queue failed (%d failures "
+                   "total)",
+                   fail_count);
+            ok = false;
+        }
+    }
+
+    if (ok && argc == 2 && strcmp(removes, argv[1])) {
+        report(1, "ERROR: Removed value %s != expected value %s", removes,
+               argv[1]);
+        ok = false;
+    }
+
+    show_pqueue(3);
+
+    free(removes);
+    return ok && !error_check();
+}
+
+static bool do_pq_peek(int argc, char *argv[])
+{
+    if (argc != 1 && argc != 2) {
+        report(1, "%s needs 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (!pq)
+        report(3, "Warning: Calling peek on null priority queue");
+    error_check();
+
+    char *min = NULL;
+    if (exception_setup(true))
+        min = pq_peek_min(pq);
+    exception_cancel();
+
+    bool ok = true;
+    if (!min) {
+        if (argc == 2) {
+            report(1, "ERROR: Priority queue is empty, expected %s", argv[1]);
+            ok = false;
+        } else {
+            report(2, "Priority queue is empty");
+        }
+    } else {
+        report(2, "Smallest element is %s", min);
+        if (argc == 2 && strcmp(min, argv[1])) {
+            report(1, "ERROR: Smallest value %s != expected value %s", min,
+                   argv[1]);
+            ok = false;
+        }
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_pq_size(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    if (!pq)
+        report(3, "Warning: Calling size on null priority queue");
+    error_check();
+
+    size_t cnt = 0;
+    if (exception_setup(true))
+        cnt = pq_size(pq);
+    exception_cancel();
+
+    bool ok = true;
+    if (cnt == pqcnt) {
+        report(2, "Priority queue size = %lu", cnt);
+    } else {
+        report(1,
+               "ERROR: Computed priority queue size as %lu, but correct value "
+               "is %lu",
+               cnt, pqcnt);
+        ok = false;
+    }
+
+    show_pqueue(3);
+    return ok && !error_check();
+}
+
+static bool do_tw_new(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (tw) {
+        report(3, "Freeing old timing wheel");
+        ok = do_tw_free(argc, argv);
+    }
+    error_check();
+
+    if (exception_setup(true))
+        tw = tw_new();
+    exception_cancel();
+    wtcnt = 0;
+    wcnt = 0;
+
+    return ok && !error_check();
+}
+
+static bool do_tw_free(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (!tw)
+        report(3, "Warning: Calling free on null timing wheel");
+    error_check();
+
+    if (wcnt > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true))
+        tw_free(tw);
+    exception_cancel();
+    set_cautious_mode(true);
+
+    tw = NULL;
+    free(wtimers);
+    wtimers = NULL;
+    wtcnt = 0;
+    wtalloc = 0;
+    wcnt = 0;
+
+    /* Blocks of the other structures are still in use */
+    size_t bcnt = q || pq || snap || lc || fz ? 0 : allocation_check();
+    if (bcnt > 0) {
+        report(1,
+               "ERROR: Freed timing wheel, but %lu blocks are still allocated",
+               bcnt);
+        ok = false;
+    }
+
+    return ok && !error_check();
+}
+
+/* Random delays spread timers over the first three levels */
+#define MAX_RAND_DELAY (1 << 18)
+
+static bool do_tw_add(int argc, char *argv[])
+{
+    int delay = 0, reps = 1;
+    bool ok = true, need_rand = false;
+    if (argc != 3 && argc != 4) {
+        report(1, "%s needs 2-3 arguments", argv[0]);
+        return false;
+    }
+
+    if (!strcmp(argv[1], "RAND"))
+        need_rand = true;
+    else if (!get_int(argv[1], &delay) || delay < 0) {
+        report(1, "Invalid delay '%s'", argv[1]);
+        return false;
+    }
+    if (argc == 4 && (!get_int(argv[3], &reps) || reps < 0)) {
+        report(1, "Invalid number of timers '%s'", argv[3]);
+        return false;
+    }
+
+    if (!tw) {
+        report(3, "Warning: Calling add on null timing wheel");
+        return !error_check();
+    }
+    error_check();
+
+    if (wtcnt + reps > wtalloc) {
+        int size = wtalloc ? wtalloc : 16;
+        while (size < wtcnt + reps)
+            size *= 2;
+        wtimer_t *grown = realloc(wtimers, size * sizeof(wtimer_t));
+        if (!grown) {
+            report(1, "INTERNAL ERROR.  Could not allocate space for timers");
+            return false;
+        }
+        wtimers = grown;
+        wtalloc = size;
+    }
+
+    if (exception_setup(true)) {
+        for (int r = 0; ok && r < reps; r++) {
+            if (need_rand)
+                delay = 1 + rand() % MAX_RAND_DELAY;
+            tw_timer_t *t = tw_schedule(tw, delay, argv[2]);
+            if (t) {
+                wtimers[wtcnt].handle = t;
+                wtimers[wtcnt].due = tw->now + delay;
+                wtcnt++;
+                wcnt++;
+            } else {
+                fail_count++;
+                if (fail_count < fail_limit)
+                    report(2, "Scheduling of %s failed", argv[2]);
+                else {
+                    report(1,
+                           "ERROR: Scheduling of %s failed (%d failures "
+                           "total)",
+                           argv[2], fail_count);
+                    ok = false;
+                }
+            }
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    return ok;
+}
+
+static bool do_tw_cancel(int argc, char *argv[])
+{
+    int first, reps = 1;
+    bool ok = true;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &first) || first < 0) {
+        report(1, "Invalid timer number '%s'", argv[1]);
+        return false;
+    }
+    if (argc == 3 && (!get_int(argv[2], &reps) || reps < 0)) {
+        report(1, "Invalid number of timers '%s'", argv[2]);
+        return false;
+    }
+
+    if (!tw) {
+        report(3, "Warning: Calling cancel on null timing wheel");
+        return !error_check();
+    }
+    if (first + reps > wtcnt) {
+        report(1, "Only %d timers were scheduled", wtcnt);
+        return false;
+    }
+    error_check();
+
+    if (wcnt > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true)) {
+        for (int i = first; ok && i < first + reps; i++) {
+            if (!wtimers[i].handle) {
+                report(1, "ERROR: Timer %d is already gone", i);
+                ok = false;
+                break;
+            }
+            tw_cancel(tw, wtimers[i].handle);
+            wtimers[i].handle = NULL;
+            wcnt--;
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+    set_cautious_mode(true);
+
+    return ok;
+}
+
+static bool do_tw_tick(int argc, char *argv[])
+{
+    int ticks = 1;
+    if (argc != 1 && argc != 2) {
+        report(1, "%s needs 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (argc == 2 && (!get_int(argv[1], &ticks) || ticks < 0)) {
+        report(1, "Invalid number of ticks '%s'", argv[1]);
+        return false;
+    }
+
+    if (!tw) {
+        report(3, "Warning: Calling tick on null timing wheel");
+        return !error_check();
+    }
+
+    char *removes = malloc(string_length + 1);
+    if (!removes) {
+        report(1,
+               "INTERNAL ERROR.  Could not allocate space for removed strings");
+        return false;
+    }
+    error_check();
+
+    bool ok = true;
+    int cnt = 0;
+    uint64_t last = 0;
+    if (wcnt > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true)) {
+        tw_advance(tw, ticks);
+        uint64_t due;
+        while (ok && tw_pop(tw, removes, string_length + 1, &due)) {
+            if (cnt < big_queue_size)
+                report(2, "Expired %s, due at %lu", removes,
+                       (unsigned long) due);
+            if (due > tw->now || due < last) {
+                report(1, "ERROR: Expired %s due at %lu, at tick %lu",
+                       removes, (unsigned long) due,
+                       (unsigned long) tw->now);
+                ok = false;
+            }
+            last = due;
+            cnt++;
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+    set_cautious_mode(true);
+    free(removes);
+
+    /* Every timer due by now, and only those, must have expired */
+    int expected = 0;
+    for (int i = 0; i < wtcnt; i++) {
+        if (wtimers[i].handle && wtimers[i].due <= tw->now) {
+            wtimers[i].handle = NULL;
+            expected++;
+        }
+    }
+    wcnt -= expected;
+    if (ok && cnt != expected) {
+        report(1, "ERROR: %d timers expired, but %d were due", cnt,
+               expected);
+        ok = false;
+    }
+    if (ok && tw_pending(tw) != (size_t) wcnt) {
+        report(1, "ERROR: %lu timers pending, but %d should be",
+               tw_pending(tw), wcnt);
+        ok = false;
+    }
+    report(2, "Clock at tick %lu, %d expired, %d pending",
+           (unsigned long) tw->now, cnt, wcnt);
+
+    return ok && !error_check();
+}
+
+static bool do_lru_new(int argc, char *argv[])
+{
+    int limit;
+    bool bytes = false;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &limit) || limit < 0) {
+        report(1, "Invalid capacity '%s'", argv[1]);
+        return false;
+    }
+    if (argc == 3) {
+        if (strcmp(argv[2], "bytes")) {
+            report(1, "Unknown unit '%s'", argv[2]);
+            return false;
+        }
+        bytes = true;
+    }
+
+    bool ok = true;
+    if (lc) {
+        report(3, "Freeing old cache");
+        char *args[] = {"lfree"};
+        ok = do_lru_free(1, args);
+    }
+    error_check();
+
+    if (exception_setup(true))
+        lc = lru_new(limit, bytes);
+    exception_cancel();
+
+    return ok && !error_check();
+}
+
+static bool do_lru_free(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    bool ok = true;
+    if (!lc)
+        report(3, "Warning: Calling free on null cache");
+    error_check();
+
+    if (lru_size(lc) > big_queue_size)
+        set_cautious_mode(false);
+    if (exception_setup(true))
+        lru_free(lc);
+    exception_cancel();
+    set_cautious_mode(true);
+
+    lc = NULL;
+
+    /* Blocks of the other structures are still in use */
+    size_t bcnt = q || pq || snap || tw || fz ? 0 : allocation_check();
+    if (bcnt > 0) {
+        report(1, "ERROR: Freed cache, but %lu blocks are still allocated",
+               bcnt);
+        ok = false;
+    }
+
+    return ok && !error_check();
+}
+
+static bool do_lru_put(int argc, char *argv[])
+{
+    if (argc != 3) {
+        report(1, "%s needs 2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!lc)
+        report(3, "Warning: Calling put on null cache");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = lru_put(lc, argv[1], argv[2]);
+    exception_cancel();
+
+    bool ok = true;
+    if (!rval) {
+        fail_count++;
+        if (fail_count < fail_limit)
+            report(2, "Insertion of %s failed", argv[1]);
+        else {
+            report(1, "ERROR: Insertion of %s failed (%d failures total)",
+                   argv[1], fail_count);
+            ok = false;
+        }
+    }
+
+    show_lru(3);
+    return ok && !error_check();
+}
+
+static bool do_lru_get(int argc, char *argv[])
+{
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!lc)
+        report(3, "Warning: Calling get on null cache");
+    error_check();
+
+    char *data = NULL;
+    if (exception_setup(true))
+        data = lru_get(lc, argv[1]);
+    exception_cancel();
+
+    bool ok = true;
+    if (!data) {
+        report(2, "%s missed", argv[1]);
+        if (argc == 3) {
+            report(1, "ERROR: %s missed, expected %s", argv[1], argv[2]);
+            ok = false;
+        }
+    } else {
+        report(2, "%s hit: %s", argv[1], data);
+        if (argc == 3 && strcmp(data, argv[2])) {
+            report(1, "ERROR: Value of %s is %s, expected %s", argv[1], data,
+                   argv[2]);
+            ok = false;
+        }
+        if (strcmp(lc->q->head->value, argv[1])) {
+            report(1, "ERROR: %s hit, but is not the most recently used",
+                   argv[1]);
+            ok = false;
+        }
+    }
+
+    show_lru(3);
+    return ok && !error_check();
+}
+
+static bool do_lru_remove(int argc, char *argv[])
+{
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!lc)
+        report(3, "Warning: Calling remove on null cache");
+    error_check();
+
+    bool rval = false;
+    if (exception_setup(true))
+        rval = lru_remove(lc, argv[1]);
+    exception_cancel();
+
+    if (rval)
+        report(2, "Removed %s from cache", argv[1]);
+    else
+        report(2, "%s not in cache", argv[1]);
+
+    show_lru(3);
+    return !error_check();
+}
+
+static bool do_lru_show(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    return show_lru(0);
+}
+
+static bool do_lru_bench(int argc, char *argv[])
+{
+    int n, keys, capacity;
+    double skew = 0.99;
+    if (argc != 4 && argc != 5) {
+        report(1, "%s needs 3-4 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of lookups '%s'", argv[1]);
+        return false;
+    }
+    if (!get_int(argv[2], &keys) || keys < 1) {
+        report(1, "Invalid number of keys '%s'", argv[2]);
+        return false;
+    }
+    if (!get_int(argv[3], &capacity) || capacity < 1) {
+        report(1, "Invalid capacity '%s'", argv[3]);
+        return false;
+    }
+    if (argc == 5) {
+        char *end;
+        skew = strtod(argv[4], &end);
+        if (*end || !(skew >= 0)) {
+            report(1, "Invalid skew '%s'", argv[4]);
+            return false;
+        }
+    }
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    cache_result_t res;
+    bool ok = bench_lru(n, keys, capacity, skew, &res);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Could not run the cache workload");
+        return false;
+    }
+
+    report(2, "LRU cache: %ld lookups in %.3f seconds, %.2f M ops/s",
+           res.gets, res.seconds,
+           (res.gets + res.gets - res.hits) / res.seconds / 1e6);
+    report(2, "Hit rate %.1f%%, %ld evictions", 100.0 * res.hits / res.gets,
+           res.evictions);
+
+    return !error_check();
+}
+
+static bool do_small_bench(int argc, char *argv[])
+{
+    int n;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of cycles '%s'", argv[1]);
+        return false;
+    }
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    double inline_ns, spilled_ns;
+    bool ok = bench_small_queues(n, &inline_ns, &spilled_ns);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Could not run the small queue workload");
+        return false;
+    }
+
+    report(2, "Small queues: %.0f ns per cycle inline, %.0f ns spilled",
+           inline_ns, spilled_ns);
+
+    return !error_check();
+}
+
+static void report_phases(char *name, long n, phase_result_t *res)
+{
+    report(2,
+           "%s: insert %.0f ns, reverse %.0f ns, sort %.0f ns, remove %.0f ns "
+           "per value",
+           name, res->insert * 1e9 / n, res->reverse * 1e9 / n,
+           res->sort * 1e9 / n, res->remove * 1e9 / n);
+}
+
+static bool do_typed_bench(int argc, char *argv[])
+{
+    long n;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_long(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of values '%s'", argv[1]);
+        return false;
+    }
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    phase_result_t typed, str;
+    bool ok = bench_typed_queue(n, &typed, &str);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Typed and string queues disagree, or could not "
+                  "allocate space");
+        return false;
+    }
+
+    report_phases("u64 queue", n, &typed);
+    report_phases("String queue", n, &str);
+
+    return !error_check();
+}
+
+static bool do_locale(int argc, char *argv[])
+{
+    if (argc != 1 && argc != 2) {
+        report(1, "%s takes 0-1 arguments", argv[0]);
+        return false;
+    }
+
+    if (argc == 2 && !setlocale(LC_COLLATE, argv[1])) {
+        report(1, "Locale '%s' is not available", argv[1]);
+        return false;
+    }
+    report(2, "Collating in locale %s", setlocale(LC_COLLATE, NULL));
+
+    return true;
+}
+
+static bool do_locale_bench(int argc, char *argv[])
+{
+    long n;
+    if (argc != 2) {
+        report(1, "%s needs 1 argument", argv[0]);
+        return false;
+    }
+
+    if (!get_long(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of words '%s'", argv[1]);
+        return false;
+    }
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    double keyed, naive;
+    bool ok = bench_locale_sort(n, &keyed, &naive);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Sorts by key and by strcoll disagree, or could not "
+                  "allocate space");
+        return false;
+    }
+
+    report(2, "Locale sort of %ld words: %.3f seconds by key, %.3f by strcoll",
+           n, keyed, naive);
+
+    return !error_check();
+}
+
+static void report_blob_phases(char *name, long n, blob_result_t *res)
+{
+    report(2,
+           "%s: insert %.0f ns, split and splice %.0f ns, remove %.0f ns "
+           "per value",
+           name, res->insert * 1e9 / n, res->splice * 1e9 / n,
+           res->remove * 1e9 / n);
+}
+
+static bool do_blob_bench(int argc, char *argv[])
+{
+    long n, pct = 10, len = 65536;
+    if (argc < 2 || argc > 4) {
+        report(1, "%s needs 1-3 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_long(argv[1], &n) || n < 1) {
+        report(1, "Invalid number of values '%s'", argv[1]);
+        return false;
+    }
+    if (argc > 2 && (!get_long(argv[2], &pct) || pct < 0 || pct > 100)) {
+        report(1, "Invalid percentage '%s'", argv[2]);
+        return false;
+    }
+    if (argc > 3 && (!get_long(argv[3], &len) || len < 1024)) {
+        report(1, "Invalid value length '%s'", argv[3]);
+        return false;
+    }
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    blob_result_t heap, blob;
+    bool ok = bench_blobs(n, pct, len, &heap, &blob);
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (!ok) {
+        report(1, "ERROR: Values came back wrong, or could not allocate "
+                  "space");
+        return false;
+    }
+
+    report_blob_phases("Heap", n, &heap);
+    report_blob_phases("Blob region", n, &blob);
+
+    return !error_check();
+}
+
+/*
+ * Rough footprint of a short element: the element and its string, each
+ * in a block with the harness' header and footer and malloc's own.
+ */
+#define STRESS_ELEMENT_BYTES 160
+
+static bool do_stress(int argc, char *argv[])
+{
+    int pct;
+    long max = LONG_MAX;
+    if (argc != 2 && argc != 3) {
+        report(1, "%s needs 1-2 arguments", argv[0]);
+        return false;
+    }
+
+    if (!get_int(argv[1], &pct) || pct < 1 || pct > 100) {
+        report(1, "Invalid percentage of memory '%s'", argv[1]);
+        return false;
+    }
+    if (argc == 3 && (!get_long(argv[2], &max) || max < 1)) {
+        report(1, "Invalid maximum number of elements '%s'", argv[2]);
+        return false;
+    }
+
+    long pages = sysconf(_SC_AVPHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    if (pages < 0 || page < 0) {
+        report(1, "ERROR: Could not tell how much memory is available");
+        return false;
+    }
+    size_t n = (size_t) pages * page / 100 * pct / STRESS_ELEMENT_BYTES;
+    if (n > (size_t) max)
+        n = max;
+    report(2, "Filling a queue with %lu elements (INT_MAX is %d)", n,
+           INT_MAX);
+
+    int saved_fail_probability = fail_probability;
+    fail_probability = 0;
+    set_cautious_mode(false);
+    size_t bcnt = allocation_check();
+    bool ok = true;
+    size_t cnt = 0;
+    queue_t *sq = NULL;
+    /* The count depends on the host, so no time limit applies */
+    if (exception_setup(false)) {
+        sq = q_new();
+        ok = sq != NULL;
+        while (ok && cnt < n) {
+            ok = q_insert_tail(sq, "x");
+            cnt += ok;
+        }
+        if (!ok)
+            report(1, "ERROR: Insertion failed after %lu elements", cnt);
+        if (ok && q_size(sq) != n) {
+            report(1, "ERROR: Queue holds %lu elements, expected %lu",
+                   q_size(sq), n);
+            ok = false;
+        }
+        /* Removing half of them must bring the count down exactly */
+        for (size_t i = 0; ok && i < n / 2; i++)
+            ok = q_remove_head(sq, NULL, 0);
+        if (ok && q_size(sq) != n - n / 2) {
+            report(1, "ERROR: Queue holds %lu elements, expected %lu",
+                   q_size(sq), n - n / 2);
+            ok = false;
+        }
+        q_free(sq);
+        ok = ok && !error_check();
+    }
+    exception_cancel();
+    set_cautious_mode(true);
+    fail_probability = saved_fail_probability;
+
+    if (ok && allocation_check() != bcnt) {
+        report(1, "ERROR: Freed stress queue, but %lu blocks are still "
+                  "allocated",
+               allocation_check() - bcnt);
+        ok = false;
+    }
+    if (ok)
+        report(2, "Queue of %lu elements checked", n);
+
+    return ok && !error_check();
+}
+
+static bool show_lru(int vlevel)
+{
+    if (verblevel < vlevel)
+        return true;
+
+    if (!lc) {
+        report(vlevel, "cache = NULL");
+        return true;
+    }
+
+    bool ok = true;
+    int cnt = 0;
+    report_noreturn(vlevel, "cache = [");
+    if (exception_setup(true)) {
+        for (list_ele_t *e = lc->q->head; ok && e; e = e->next) {
+            if (cnt < big_queue_size)
+                report_noreturn(vlevel, cnt == 0 ? "%s=%s" : " %s=%s",
+                                e->value, ((lru_entry_t *) e)->data);
+            cnt++;
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    report(vlevel, cnt > big_queue_size ? " ... ]" : "]");
+    report(vlevel, "%ld hits, %ld misses, %ld evictions", lc->hits, lc->misses,
+           lc->evictions);
+
+    return ok;
+}
+
+static bool show_queue(int vlevel)
+{
+    bool ok = true;
+    if (verblevel < vlevel)
+        return true;
+
+    size_t cnt = 0;
+    if (!q) {
+        report(vlevel, "q = NULL");
+        return true;
+    }
+
+    report_noreturn(vlevel, "q = [");
+    list_ele_t *e = q->head;
+    if (exception_setup(true)) {
+        while (ok && e && cnt < qcnt) {
+            if (cnt < big_queue_size)
+                report_noreturn(vlevel, cnt == 0 ? "%s" : " %s", e->value);
+            e = e->next;
+            cnt++;
+            ok = ok && !error_check();
+        }
+    }
+    exception_cancel();
+
+    if (!ok) {
+        report(vlevel, " ... ]");
+        return false;
+    }
+
+    if (!e) {
+        if (cnt <= big_queue_size)
+            report(vlevel, "]");
+        else
+            report(vlevel, " ... ]");
+    } else {
+        report(vlevel, " ... ]");
+        report(
+            vlevel,
+            "ERROR:  Either list has cycle, or queue has more than %lu elements",
+            qcnt);
+        ok = false;
+    }
+
+    return ok;
+}
+
+static bool do_show(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+    return show_queue(0);
+}
+
+static bool do_bounds(int argc, char *argv[])
+{
+    if (argc != 1) {
+        report(1, "%s takes no arguments", argv[0]);
+        return false;
+    }
+
+    if (!q) {
+        report(3, "Warning: Calling bounds on null queue");
+        return !error_check();
+    }
+
+    static const char *const names[] = {"reject", "block", "drop oldest",
+                                        "drop newest"};
+    if (q->limit) {
+        report(1, "Capacity %lu %s, policy %s", (unsigned long) q->limit,
+               q->limit_bytes ? "bytes" : "elements", names[q->policy]);
+    } else {
+        report(1, "Unbounded");
+    }
+    report(1, "Holding %lu elements in %lu bytes", q->size,
+           (unsigned long) q->bytes);
+    report(1, "Rejected %ld, dropped %ld", q->rejected, q->dropped);
+
+    return !error_check();
+}
+
+/* Apply the capacity options to the current queue */
+static void apply_capacity()
+{
+    if (q)
+        q_set_capacity(q, capacity, capacity_bytes, policy);
+}
+
+static void set_capacity(int oldval)
+{
+    if (capacity < 0) {
+        report(1, "Capacity must not be negative");
+        capacity = oldval;
+    }
+    apply_capacity();
+}
+
+static void set_policy(int oldval)
+{
+    if (policy < Q_REJECT || policy > Q_DROP_NEWEST) {
+        report(1, "Policy must be between %d and %d", Q_REJECT, Q_DROP_NEWEST);
+        policy = oldval;
+    }
+    apply_capacity();
+}
+
+/* Signal handlers */
+static void sigsegvhandler(int sig)
+{
+    report(1,
+           "Segmentation fault occurred.  You dereferenced a NULL or invalid "
+           "pointer");
+    /* Raising a SIGABRT signal to produce a core dump for debugging. */
+    abort();
+}
+
+static void sigalrmhandler(int sig)
+{
+    trigger_exception(
+        "Time limit exceeded.  Either you are in an infinite loop, or your "
+        "code is too inefficient");
+}
+
+static void queue_init()
+{
+    fail_count = 0;
+    q = NULL;
+    signal(SIGSEGV, sigsegvhandler);
+    signal(SIGALRM, sigalrmhandler);
+}
+
+static bool queue_quit(int argc, char *argv[])
+{
+    report(3, "Freeing queue");
+    if (qcnt > big_queue_size || pqcnt > big_queue_size ||
+        snapcnt > big_queue_size || wcnt > big_queue_size ||
+        lru_size(lc) > big_queue_size || (fz && fz->size > big_queue_size))
+        set_cautious_mode(false);
+
+    if (exception_setup(true)) {
+        q_snapshot_free(snap);
+        q_free(q);
+        pq_free(pq);
+        tw_free(tw);
+        lru_free(lc);
+        fz_free(fz);
+        bl_free(blobs);
+    }
+    free(wtimers);
     exception_cancel();
     set_cautious_mode(true);
 
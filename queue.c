@@ -1,25 +1,47 @@
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h> /* strcasecmp */
 
+#include "blob.h"
+#include "bloom.h"
 #include "harness.h"
+#include "hash.h"
+#include "hashidx.h"
+#include "intern.h"
+#include "posidx.h"
 #include "queue.h"
+#include "skiplist.h"
 
 /******** Utility Zone ********/
 
-static inline int smaller(int a, int b)
+/* Length of the value v of q, which large values record in their header */
+static inline size_t value_len(queue_t *q, const char *v)
 {
-    return a < b ? a : b;
+    return bl_owns(q->blobs, v) ? bl_length(v) : strlen(v);
 }
 
-static inline void increase_size(queue_t *q)
+static inline void increase_size(queue_t *q, list_ele_t *e)
 {
     q->size += 1;
+    q->bytes += value_len(q, e->value) + 1;
 }
 
-static inline void decrease_size(queue_t *q)
+static inline void decrease_size(queue_t *q, list_ele_t *e)
 {
     q->size -= 1;
+    q->bytes -= value_len(q, e->value) + 1;
+}
+
+/* Whether an element of len bytes fits, as if the queue held only cnt */
+static inline bool fits(queue_t *q, size_t cnt, size_t bytes, size_t len)
+{
+    if (!q->limit)
+        return true;
+
+    return q->limit_bytes ? bytes + len <= q->limit : cnt + 1 <= q->limit;
 }
 
 static bool copy_str_and_attach(list_ele_t *e, char *s)
@@ -44,6 +66,85 @@ static bool copy_str_and_attach(list_ele_t *e, char *s)
     return true;
 }
 
+/*
+ * Store s in e, sharing the pooled copy when values are interned.  A large
+ * value goes to the blob region if there is room, and to the heap if not.
+ */
+static bool attach_value(queue_t *q, list_ele_t *e, char *s)
+{
+    if (q->pool) {
+        e->value = in_acquire(q->pool, s);
+        return e->value != NULL;
+    }
+
+    if (q->blobs) {
+        size_t len = strlen(s);
+        if (len + 1 >= q->blob_min) {
+            e->value = bl_store(q->blobs, s, len);
+            if (e->value)
+                return true;
+        }
+    }
+
+    return copy_str_and_attach(e, s);
+}
+
+static inline bool is_inline(queue_t *q, list_ele_t *e)
+{
+    uintptr_t p = (uintptr_t) e, first = (uintptr_t) q->inlined;
+    return p >= first && p < first + sizeof(q->inlined);
+}
+
+/* Whether the value of e is held inside the queue, rather than allocated */
+static inline bool has_inline_value(queue_t *q, list_ele_t *e)
+{
+    return is_inline(q, e) && e->value == ((q_inline_t *) e)->value;
+}
+
+static void release_value(queue_t *q, list_ele_t *e)
+{
+    if (q->pool)
+        in_release(q->pool, e->value);
+    else if (bl_owns(q->blobs, e->value))
+        bl_release(q->blobs, e->value);
+    else if (!has_inline_value(q, e))
+        free(e->value);
+}
+
+/* Free e and its value, or hand its inline slot back */
+static void free_element(queue_t *q, list_ele_t *e)
+{
+    release_value(q, e);
+    if (is_inline(q, e))
+        q->inline_used &= ~(1U << ((q_inline_t *) e - q->inlined));
+    else
+        free(e);
+}
+
+/*
+ * Take a free inline slot for a copy of s of length len.
+ * Return NULL if none is free or s is too long.
+ */
+static list_ele_t *take_inline(queue_t *q, char *s, size_t len)
+{
+    unsigned free_slots = ~q->inline_used & ((1U << Q_INLINE) - 1);
+    if (!free_slots || len >= Q_INLINE_LEN)
+        return NULL;
+
+    int i = __builtin_ctz(free_slots);
+    q->inline_used |= 1U << i;
+
+    q_inline_t *slot = &q->inlined[i];
+    memcpy(slot->value, s, len + 1);
+    slot->ele.value = slot->value;
+    slot->ele.next = NULL;
+    slot->ele.prev = NULL;
+    slot->ele.sib_next = NULL;
+    slot->ele.sib_prev = NULL;
+
+    return &slot->ele;
+}
+
 static list_ele_t *create_element()
 {
     list_ele_t *new_e = malloc(sizeof(list_ele_t));
@@ -51,11 +152,257 @@ static list_ele_t *create_element()
         return NULL;
 
     new_e->next = NULL;
+    new_e->prev = NULL;
+    new_e->sib_next = NULL;
+    new_e->sib_prev = NULL;
     new_e->value = NULL;
 
     return new_e;
 }
 
+static inline bool in_sorted_mode(queue_t *q)
+{
+    return q->index && !q->index->stale;
+}
+
+/* Whether the positional index still follows the chain */
+static inline bool has_positions(queue_t *q)
+{
+    return q->pos && !q->pos->stale;
+}
+
+/* Leave the positional index to be rebuilt by the next lookup */
+static inline void lose_positions(queue_t *q)
+{
+    if (q->pos)
+        q->pos->stale = true;
+}
+
+/*
+ * Rebuild a stale positional index.
+ * Return false if q has none, or could not allocate space for it.
+ */
+static bool refresh_positions(queue_t *q)
+{
+    if (!q->pos || !q->pos->stale)
+        return q->pos != NULL;
+
+    posidx_t *pi = pi_new(q->head, q->blobs);
+    if (!pi)
+        return false;
+    pi_free(q->pos);
+    q->pos = pi;
+
+    return true;
+}
+
+/*
+ * The towers of an index gone stale cannot be freed by q_reverse, which must
+ * not call free, so release them on the next insertion instead.
+ */
+static inline void release_stale_index(queue_t *q)
+{
+    if (q->index && q->index->stale) {
+        sl_free(q->index);
+        q->index = NULL;
+    }
+}
+
+/*
+ * Create an element holding a copy of s, with room for it in the hash index.
+ * Return NULL if could not allocate space.
+ */
+static list_ele_t *new_element(queue_t *q, char *s)
+{
+    list_ele_t *e = q->pool || q->pos ? NULL : take_inline(q, s, strlen(s));
+    if (!e) {
+        e = create_element();
+        if (!e)
+            return NULL;
+
+        if (!attach_value(q, e, s)) {
+            free(e);
+
+            return NULL;
+        }
+    }
+
+    if (q->hidx && !hi_reserve(q->hidx)) {
+        free_element(q, e);
+
+        return NULL;
+    }
+
+    return e;
+}
+
+/*
+ * Rebuild the Bloom filter for twice as many values once it is full.  If
+ * that fails the old one stays, which only lets more false positives in.
+ */
+static void grow_bloom(queue_t *q)
+{
+    if (q->bloom->count <= q->bloom->capacity)
+        return;
+
+    bloom_t *bf = bf_new(q->bloom->capacity * 2, q->bloom->fp_rate);
+    if (!bf)
+        return;
+
+    for (list_ele_t *e = q->head; e; e = e->next)
+        bf_add(bf, e->value);
+    bf_free(q->bloom);
+    q->bloom = bf;
+}
+
+/* Enter the freshly linked element e into every index */
+static void index_element(queue_t *q, list_ele_t *e)
+{
+    if (has_positions(q)) {
+        if (e == q->head)
+            pi_insert(q->pos, q->head, 0);
+        else if (e == q->tail)
+            pi_insert(q->pos, q->head, q->size - 1);
+        else
+            lose_positions(q);
+    }
+    if (q->hidx)
+        hi_add(q->hidx, e);
+    if (q->bloom) {
+        bf_add(q->bloom, e->value);
+        grow_bloom(q);
+    }
+}
+
+/* Take e out of the list and every index, without freeing it */
+static void unlink_element(queue_t *q, list_ele_t *e)
+{
+    if (has_positions(q)) {
+        if (e == q->head)
+            pi_remove(q->pos, q->head, 0);
+        else if (e == q->tail)
+            pi_remove(q->pos, q->head, q->size - 1);
+        else
+            lose_positions(q);
+    }
+    if (in_sorted_mode(q)) {
+        if (e == q->head)
+            sl_remove_head(q->index, e);
+        else
+            sl_remove(q->index, e);
+    }
+    if (q->hidx)
+        hi_remove(q->hidx, e);
+    if (q->bloom)
+        bf_remove(q->bloom, e->value);
+
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        q->head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        q->tail = e->prev;
+
+    decrease_size(q, e);
+}
+
+/* Free elements removed while snapshots could still see them */
+static void free_retired(queue_t *q)
+{
+    while (q->retired) {
+        list_ele_t *e = q->retired;
+        q->retired = e->sib_next;
+        free_element(q, e);
+    }
+}
+
+/*
+ * Copy size elements starting at head into a queue of their own.
+ * Return NULL if could not allocate space.
+ */
+static queue_t *copy_range(list_ele_t *head, size_t size)
+{
+    queue_t *copy = q_new();
+    if (!copy)
+        return NULL;
+
+    list_ele_t *e = head;
+    for (size_t i = 0; i < size; i++, e = e->next) {
+        if (!q_insert_tail(copy, e->value)) {
+            q_free(copy);
+            return NULL;
+        }
+    }
+
+    return copy;
+}
+
+/*
+ * Give every snapshot a private copy before the source relinks the elements
+ * they share.  A snapshot whose copy cannot be allocated is marked lost.
+ */
+static void unshare(queue_t *q)
+{
+    while (q->snaps) {
+        snapshot_t *snap = q->snaps;
+        q->snaps = snap->next;
+        snap->next = NULL;
+        snap->source = NULL;
+
+        snap->copy = copy_range(snap->head, snap->size);
+        if (snap->copy) {
+            snap->head = snap->copy->head;
+        } else {
+            snap->lost = true;
+            snap->head = NULL;
+            snap->size = 0;
+        }
+    }
+
+    free_retired(q);
+}
+
+/*
+ * Apply the overflow policy of a bounded queue that s does not fit in.
+ * Under Q_DROP_OLDEST only check that room can be made: drop_oldest makes
+ * it once the new element is allocated, so a failed insertion drops nothing.
+ * Return false if s must not be inserted.
+ */
+static bool make_room(queue_t *q, char *s)
+{
+    size_t len = strlen(s) + 1;
+    if (fits(q, q->size, q->bytes, len))
+        return true;
+
+    switch (q->policy) {
+    case Q_DROP_NEWEST:
+        q->dropped++;
+        return false;
+    case Q_DROP_OLDEST:
+        /* Nothing to evict can make room for a string longer than it all */
+        if (fits(q, 0, 0, len))
+            return true;
+        break;
+    default:
+        break;
+    }
+
+    q->rejected++;
+    return false;
+}
+
+/* Remove elements from the head until e, allocated but not linked, fits */
+static void drop_oldest(queue_t *q, list_ele_t *e)
+{
+    size_t len = value_len(q, e->value) + 1;
+    while (!fits(q, q->size, q->bytes, len)) {
+        q_remove_head(q, NULL, 0);
+        q->dropped++;
+    }
+}
+
 /******** End of Utility Zone ********/
 
 /*
@@ -73,6 +420,23 @@ queue_t *q_new()
     q->head = NULL;
     q->tail = NULL;
     q->size = 0;
+    q->bytes = 0;
+    q->limit = 0;
+    q->limit_bytes = false;
+    q->policy = Q_REJECT;
+    q->rejected = 0;
+    q->dropped = 0;
+    q->index = NULL;
+    q->hidx = NULL;
+    q->pos = NULL;
+    q->bloom = NULL;
+    q->blobs = NULL;
+    q->blob_min = 0;
+    q->pool = NULL;
+    q->snaps = NULL;
+    q->retired = NULL;
+    q->orphaned = false;
+    q->inline_used = 0;
 
     return q;
 }
@@ -83,16 +447,29 @@ void q_free(queue_t *q)
     if (!q)
         return;
 
+    /* Snapshots still see the elements, so the last of them frees it all */
+    if (q->snaps) {
+        q->orphaned = true;
+        return;
+    }
+
+    /* Pooled values all go at once with the pool, inline ones with q */
     list_ele_t *e = q->head;
     while (e) {
-        if (e->value)
-            free(e->value);
+        if (e->value && !q->pool)
+            release_value(q, e);
 
         list_ele_t *old = e;
         e = e->next;
-        free(old);
+        if (!is_inline(q, old))
+            free(old);
     }
 
+    sl_free(q->index);
+    hi_free(q->hidx);
+    pi_free(q->pos);
+    bf_free(q->bloom);
+    in_free(q->pool);
     free(q);
 }
 
@@ -102,31 +479,39 @@ void q_free(queue_t *q)
  * Return false if q is NULL or could not allocate space.
  * Argument s points to the string to be stored.
  * The function must explicitly allocate space and copy the string into it.
+ * In sorted mode the element goes to its ordered position instead.
  */
 bool q_insert_head(queue_t *q, char *s)
 {
     if (!q)
         return false;
 
-    list_ele_t *e = create_element();
-    if (!e)
-        return false;
+    release_stale_index(q);
+    if (in_sorted_mode(q))
+        return q_insert(q, s);
 
-    if (!copy_str_and_attach(e, s)) {
-        free(e);
+    /* A dropped newcomer still counts as inserted */
+    if (q->limit && !make_room(q, s))
+        return q->policy == Q_DROP_NEWEST;
 
+    list_ele_t *e = new_element(q, s);
+    if (!e)
         return false;
-    }
+    if (q->limit)
+        drop_oldest(q, e);
 
     if (q->head) {
         e->next = q->head;
+        q->head->prev = e;
     }
 
-    increase_size(q);
+    increase_size(q, e);
     q->head = e;
     if (q->size == 1)
         q->tail = e;
 
+    index_element(q, e);
+
     return true;
 }
 
@@ -136,33 +521,65 @@ bool q_insert_head(queue_t *q, char *s)
  * Return false if q is NULL or could not allocate space.
  * Argument s points to the string to be stored.
  * The function must explicitly allocate space and copy the string into it.
+ * In sorted mode the element goes to its ordered position instead.
  */
 bool q_insert_tail(queue_t *q, char *s)
 {
     if (!q)
         return false;
 
-    list_ele_t *e = create_element();
-    if (!e)
-        return false;
+    release_stale_index(q);
+    if (in_sorted_mode(q))
+        return q_insert(q, s);
 
-    if (!copy_str_and_attach(e, s)) {
-        free(e);
+    if (q->limit && !make_room(q, s))
+        return q->policy == Q_DROP_NEWEST;
 
+    list_ele_t *e = new_element(q, s);
+    if (!e)
         return false;
-    }
+    if (q->limit)
+        drop_oldest(q, e);
 
-    if (q->size > 0)
+    if (q->size > 0) {
         q->tail->next = e;
+        e->prev = q->tail;
+    }
 
     q->tail = e;
-    increase_size(q);
+    increase_size(q, e);
     if (q->size == 1)
         q->head = e;
 
+    index_element(q, e);
+
+    return true;
+}
+
+/*
+ * Bound queue to limit elements, or to limit bytes of strings.
+ * Return false if q is NULL.
+ */
+bool q_set_capacity(queue_t *q, size_t limit, bool bytes, q_policy_t policy)
+{
+    if (!q)
+        return false;
+
+    q->limit = limit;
+    q->limit_bytes = bytes;
+    q->policy = policy;
+
     return true;
 }
 
+/*
+ * Return true if s can be inserted without exceeding the capacity.
+ */
+bool q_fits(queue_t *q, char *s)
+{
+    return q && fits(q, q->size, q->bytes, strlen(s) + 1);
+}
+
 /*
  * Attempt to remove element from head of queue.
  * Return true if successful.
@@ -178,18 +595,143 @@ bool q_remove_head(queue_t *q, char *sp, size_t bufsize)
 
     list_ele_t *head = q->head;
     if (sp) {
-        int str_sz = smaller(bufsize - 1, strlen(head->value));
-        strncpy(sp, head->value, str_sz);
+        /* Only what fits is read, however long the value */
+        size_t str_sz = strnlen(head->value, bufsize - 1);
+        memcpy(sp, head->value, str_sz);
         sp[str_sz] = 0;
     }
 
-    free(head->value);
+    unlink_element(q, head);
+
+    /* Snapshots may still see it, so keep it until the last one goes */
+    if (q->snaps) {
+        head->sib_next = q->retired;
+        q->retired = head;
+        return true;
+    }
+
+    free_element(q, head);
+
+    return true;
+}
+
+static inline bool can_relink(queue_t *q)
+{
+    return q && !in_sorted_mode(q) && !q->pool;
+}
+
+static inline bool is_plain(queue_t *q)
+{
+    return can_relink(q) && !q->hidx && !q->bloom && !q->snaps;
+}
+
+/* Link e, unlinked, in front of next or at tail if next is NULL */
+static void link_before(queue_t *q, list_ele_t *e, list_ele_t *next)
+{
+    e->next = next;
+    e->prev = next ? next->prev : q->tail;
+    if (e->prev)
+        e->prev->next = e;
+    else
+        q->head = e;
+    if (next)
+        next->prev = e;
+    else
+        q->tail = e;
+}
+
+bool q_link_head(queue_t *q, list_ele_t *e)
+{
+    if (!can_relink(q) || !e)
+        return false;
+
+    if (q->hidx && !hi_reserve(q->hidx))
+        return false;
+
+    link_before(q, e, q->head);
+    increase_size(q, e);
+    index_element(q, e);
+
+    return true;
+}
+
+bool q_link_tail(queue_t *q, list_ele_t *e)
+{
+    if (!can_relink(q) || !e)
+        return false;
+
+    if (q->hidx && !hi_reserve(q->hidx))
+        return false;
+
+    link_before(q, e, NULL);
+    increase_size(q, e);
+    index_element(q, e);
+
+    return true;
+}
+
+bool q_unlink(queue_t *q, list_ele_t *e)
+{
+    if (!can_relink(q) || !e || is_inline(q, e))
+        return false;
+
+    /* Snapshots must not keep seeing an element the caller may free */
+    unshare(q);
+    unlink_element(q, e);
+    e->next = NULL;
+    e->prev = NULL;
+
+    return true;
+}
+
+bool q_move_head(queue_t *q, list_ele_t *e)
+{
+    if (!can_relink(q) || !e)
+        return false;
+
+    if (e == q->head)
+        return true;
 
-    q->head = head->next;
+    unshare(q);
+    lose_positions(q);
+    e->prev->next = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        q->tail = e->prev;
+    link_before(q, e, q->head);
 
-    free(head);
+    return true;
+}
+
+bool q_splice_tail(queue_t *dst, queue_t *src)
+{
+    if (!is_plain(dst) || !is_plain(src) || src->inline_used)
+        return false;
+
+    /* dst must know where the values of src are stored to free them */
+    if (src->blobs && src->blobs != dst->blobs)
+        return false;
+
+    if (!src->head || src == dst)
+        return true;
 
-    decrease_size(q);
+    lose_positions(dst);
+    lose_positions(src);
+
+    src->head->prev = dst->tail;
+    if (dst->tail)
+        dst->tail->next = src->head;
+    else
+        dst->head = src->head;
+    dst->tail = src->tail;
+    dst->size += src->size;
+    dst->bytes += src->bytes;
+
+    src->head = NULL;
+    src->tail = NULL;
+    src->size = 0;
+    src->bytes = 0;
 
     return true;
 }
@@ -198,9 +740,9 @@ bool q_remove_head(queue_t *q, char *sp, size_t bufsize)
  * Return number of elements in queue.
  * Return 0 if q is NULL or empty
  */
-int q_size(queue_t *q)
+size_t q_size(queue_t *q)
 {
-    return (q && q->size > 0 ? q->size : 0);
+    return q ? q->size : 0;
 }
 
 void swap_head_and_tail(queue_t *q, list_ele_t *head, list_ele_t *tail)
@@ -218,55 +760,83 @@ void swap_head_and_tail(queue_t *q, list_ele_t *head, list_ele_t *tail)
  * This function should not allocate or free any list elements
  * (e.g., by calling q_insert_head, q_insert_tail, or q_remove_head).
  * It should rearrange the existing ones.
+ * A queue in sorted mode leaves it.
  */
 void q_reverse(queue_t *q)
 {
     if (!q || q->size < 2)
         return;
 
+    unshare(q);
+    lose_positions(q);
+    if (q->index)
+        q->index->stale = true;
+
     list_ele_t *copy_head = q->head, *copy_tail = q->tail;
 
-    {
-        list_ele_t *a = q->head, *b = q->head->next;
+    /* Swapping the links of every element turns the list around */
+    list_ele_t *e = q->head;
+    while (e) {
+        list_ele_t *next = e->next;
+        e->next = e->prev;
+        e->prev = next;
+        e = next;
+    }
+
+    swap_head_and_tail(q, copy_head, copy_tail);
+}
+
+/*
+ * Whether a may stay before b in each sort order.  Interned values are equal
+ * exactly when they are the same pointer.
+ */
+static inline bool before_asc(list_ele_t *a, list_ele_t *b)
+{
+    return a->value == b->value || strcmp(a->value, b->value) <= 0;
+}
 
-        a->next = NULL;
+static inline bool before_desc(list_ele_t *a, list_ele_t *b)
+{
+    return a->value == b->value || strcmp(a->value, b->value) >= 0;
+}
 
-        while ((a && b)) {
-            list_ele_t *c = b->next;
-            /* Revert b to a */
-            b->next = a;
+static inline bool before_nocase(list_ele_t *a, list_ele_t *b)
+{
+    return a->value == b->value || strcasecmp(a->value, b->value) <= 0;
+}
 
-            /* Shift a and b */
-            a = b;
-            b = c;
-        }
-    }
+/* Leading number of s, 0 if none; NaN goes first, like -inf */
+static inline double numeric_key(const char *s)
+{
+    double d = strtod(s, NULL);
+    return d == d ? d : -HUGE_VAL;
+}
 
-    swap_head_and_tail(q, copy_head, copy_tail);
+static inline bool before_numeric(list_ele_t *a, list_ele_t *b)
+{
+    return a->value == b->value ||
+           numeric_key(a->value) <= numeric_key(b->value);
 }
 
-static inline void swap_if_larger(list_ele_t *a, list_ele_t *b)
+static inline bool before_collate(list_ele_t *a, list_ele_t *b)
 {
-    if (strcmp(a->value, b->value) > 0) {
-        char *t = a->value;
-        a->value = b->value;
-        b->value = t;
-    }
+    return a->value == b->value || strcoll(a->value, b->value) <= 0;
 }
 
-static inline bool is_ascending(list_ele_t *a, list_ele_t *b)
+/* The order of sorted mode, which also ranks equal values */
+static inline bool before_ranked(list_ele_t *a, list_ele_t *b)
 {
-    return (strcmp(a->value, b->value) <= 0);
+    return sl_compare(a, b) <= 0;
 }
 
 static void split_list(list_ele_t *e,
-                       const int SZ,
+                       const size_t SZ,
                        list_ele_t **a,
                        list_ele_t **b)
 {
     /* the first half of the list */
     list_ele_t *head_a = e, *last = e;
-    for (int i = 0; i < SZ / 2; i++) {
+    for (size_t i = 0; i < SZ / 2; i++) {
         last = last->next;
     }
 
@@ -278,71 +848,920 @@ static void split_list(list_ele_t *e,
     *b = head_b;
 }
 
-list_ele_t *q_do_sort(list_ele_t *e, const int SZ)
-{
-    /* no need to sort */
-    if (SZ < 2)
-        return e;
-
-    /* if only two elements, compare and sort them */
-    if (SZ == 2) {
-        swap_if_larger(e, e->next);
-
-        return e;
+/*
+ * Define sort_<order>, a stable merge sort of the SZ elements starting at e
+ * through next, calling before_<order> directly so that every order gets
+ * its comparison inlined rather than called through a pointer.
+ */
+#define DEFINE_SORT(order)                                                    \
+    static list_ele_t *sort_##order(list_ele_t *e, const size_t SZ)           \
+    {                                                                         \
+        /* no need to sort */                                                 \
+        if (SZ < 2)                                                           \
+            return e;                                                         \
+                                                                              \
+        /*                                                                    \
+         * if only two elements, compare and sort them.  Relink rather than   \
+         * swap values, since the indexes point at the elements holding them. \
+         */                                                                   \
+        if (SZ == 2) {                                                        \
+            list_ele_t *f = e->next;                                          \
+            if (before_##order(e, f))                                         \
+                return e;                                                     \
+                                                                              \
+            e->next = f->next;                                                \
+            f->next = e;                                                      \
+                                                                              \
+            return f;                                                         \
+        }                                                                     \
+                                                                              \
+        list_ele_t *head_a, *head_b;                                          \
+        split_list(e, SZ, &head_a, &head_b);                                  \
+                                                                              \
+        head_a = sort_##order(head_a, SZ / 2 + 1);                            \
+        head_b = sort_##order(head_b, SZ - SZ / 2 - 1);                       \
+                                                                              \
+        /* combine */                                                         \
+                                                                              \
+        list_ele_t *a = head_a, *b = head_b, *m = NULL, *head_m = NULL;       \
+        if (before_##order(a, b)) {                                           \
+            m = a;                                                            \
+            a = a->next;                                                      \
+        } else {                                                              \
+            m = b;                                                            \
+            b = b->next;                                                      \
+        }                                                                     \
+        head_m = m;                                                           \
+        while (a && b) {                                                      \
+            if (before_##order(a, b)) {                                       \
+                m->next = a;                                                  \
+                a = a->next;                                                  \
+            } else {                                                          \
+                m->next = b;                                                  \
+                b = b->next;                                                  \
+            }                                                                 \
+            m = m->next;                                                      \
+        }                                                                     \
+                                                                              \
+        list_ele_t *other = (a ? a : b);                                      \
+        while (true) {                                                        \
+            m->next = other;                                                  \
+            m = m->next;                                                      \
+            if (!(other = other->next))                                       \
+                break;                                                        \
+        }                                                                     \
+        m->next = NULL;                                                       \
+                                                                              \
+        return head_m;                                                        \
     }
 
-    list_ele_t *head_a, *head_b;
-    split_list(e, SZ, &head_a, &head_b);
+DEFINE_SORT(asc)
+DEFINE_SORT(desc)
+DEFINE_SORT(nocase)
+DEFINE_SORT(numeric)
+DEFINE_SORT(collate)
+DEFINE_SORT(ranked)
 
-    head_a = q_do_sort(head_a, SZ / 2 + 1);
-    head_b = q_do_sort(head_b, SZ - SZ / 2 - 1);
+/* Bytes of each collation key kept with its element while sorting */
+#define KEY_PREFIX 16
 
-    /* combine */
+typedef struct {
+    list_ele_t *ele;
+    size_t len; /* Length of the whole key */
+    unsigned char prefix[KEY_PREFIX];
+} sort_key_t;
 
-    list_ele_t *a = head_a, *b = head_b, *m = NULL, *head_m = NULL;
-    if (is_ascending(a, b)) {
-        m = a;
-        a = a->next;
-    } else {
-        m = b;
-        b = b->next;
-    }
-    head_m = m;
-    while (a && b) {
-        if (is_ascending(a, b)) {
-            m->next = a;
-            a = a->next;
-        } else {
-            m->next = b;
-            b = b->next;
+/* Compare by the key prefixes, and by strcoll only when both go on */
+static inline int key_cmp(const sort_key_t *a, const sort_key_t *b)
+{
+    size_t m = a->len < b->len ? a->len : b->len;
+    if (m > KEY_PREFIX)
+        m = KEY_PREFIX;
+
+    int c = memcmp(a->prefix, b->prefix, m);
+    if (c)
+        return c;
+    if (a->len > KEY_PREFIX && b->len > KEY_PREFIX)
+        return strcoll(a->ele->value, b->ele->value);
+
+    /* The shorter key is a prefix of the longer one */
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+/*
+ * Stable bottom-up merge sort of n keys, alternating between keys and tmp.
+ * Return whichever of the two ends up holding them in order.
+ */
+static sort_key_t *sort_keys(sort_key_t *keys, sort_key_t *tmp, size_t n)
+{
+    for (size_t w = 1; w < n; w *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * w) {
+            size_t mid = lo + w < n ? lo + w : n;
+            size_t hi = mid + w < n ? mid + w : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                tmp[k++] = key_cmp(&keys[j], &keys[i]) < 0 ? keys[j++]
+                                                           : keys[i++];
+            while (i < mid)
+                tmp[k++] = keys[i++];
+            while (j < hi)
+                tmp[k++] = keys[j++];
         }
-        m = m->next;
+        sort_key_t *t = keys;
+        keys = tmp;
+        tmp = t;
     }
 
-    list_ele_t *other = (a ? a : b);
-    while (true) {
-        m->next = other;
-        m = m->next;
-        if (!(other = other->next))
-            break;
-    }
-    m->next = NULL;
+    return keys;
+}
+
+/*
+ * Sort the SZ elements starting at e by collation keys, each computed once
+ * by strxfrm, instead of calling strcoll in every comparison.  Only a
+ * prefix of each key is kept.  Fall back to sort_collate if the scratch
+ * memory cannot be allocated.
+ */
+static list_ele_t *sort_locale(list_ele_t *e, const size_t SZ)
+{
+    if (SZ > SIZE_MAX / (2 * sizeof(sort_key_t)))
+        return sort_collate(e, SZ);
+
+    sort_key_t *keys = malloc(2 * SZ * sizeof(sort_key_t));
+    if (!keys)
+        return sort_collate(e, SZ);
+
+    /* Whole keys that outgrow the prefix are made here */
+    char *buf = NULL;
+    size_t bufsize = 0;
+    list_ele_t *f = e;
+    for (size_t i = 0; i < SZ; i++, f = f->next) {
+        keys[i].ele = f;
+        keys[i].len = strxfrm((char *) keys[i].prefix, f->value, KEY_PREFIX);
+        if (keys[i].len < KEY_PREFIX)
+            continue;
+
+        if (keys[i].len >= bufsize) {
+            free(buf);
+            bufsize = 2 * keys[i].len;
+            buf = malloc(bufsize);
+            if (!buf) {
+                free(keys);
+                return sort_collate(e, SZ);
+            }
+        }
+        strxfrm(buf, f->value, bufsize);
+        memcpy(keys[i].prefix, buf, KEY_PREFIX);
+    }
+    free(buf);
+
+    sort_key_t *sorted = sort_keys(keys, keys + SZ, SZ);
+    for (size_t i = 0; i + 1 < SZ; i++)
+        sorted[i].ele->next = sorted[i + 1].ele;
+    sorted[SZ - 1].ele->next = NULL;
+    e = sorted[0].ele;
+    free(keys);
+
+    return e;
+}
 
-    return head_m;
+/* Make the chain sorted through next, from new_head on, that of q */
+static void adopt_sorted(queue_t *q, list_ele_t *new_head)
+{
+    q->head = new_head;
+
+    /* restore the backward links while looking for the new tail */
+    list_ele_t *new_tail = NULL;
+    for (list_ele_t *e = new_head; e; e = e->next) {
+        e->prev = new_tail;
+        new_tail = e;
+    }
+    q->tail = new_tail;
 }
 
 void q_sort(queue_t *q)
+{
+    q_sort_by(q, Q_ASC);
+}
+
+void q_sort_by(queue_t *q, q_order_t order)
 {
     /* if q has only one element, do nothing */
-    if (!q || q->size == 1)
+    if (!q || q->size < 2)
         return;
 
-    list_ele_t *new_head = q_do_sort(q->head, q->size);
-    q->head = new_head;
+    /* a queue in sorted mode is sorted already, and leaves it otherwise */
+    if (in_sorted_mode(q)) {
+        if (order == Q_ASC)
+            return;
+        q->index->stale = true;
+    }
 
-    list_ele_t *new_tail = new_head;
-    while (new_tail && new_tail->next) {
-        new_tail = new_tail->next;
+    unshare(q);
+    lose_positions(q);
+
+    list_ele_t *new_head;
+    switch (order) {
+    case Q_DESC:
+        new_head = sort_desc(q->head, q->size);
+        break;
+    case Q_NOCASE:
+        new_head = sort_nocase(q->head, q->size);
+        break;
+    case Q_NUMERIC:
+        new_head = sort_numeric(q->head, q->size);
+        break;
+    case Q_LOCALE:
+        new_head = sort_locale(q->head, q->size);
+        break;
+    case Q_COLLATE:
+        new_head = sort_collate(q->head, q->size);
+        break;
+    default:
+        new_head = sort_asc(q->head, q->size);
+        break;
     }
-    q->tail = new_tail;
+    adopt_sorted(q, new_head);
+}
+
+bool q_before(q_order_t order, list_ele_t *a, list_ele_t *b)
+{
+    switch (order) {
+    case Q_DESC:
+        return before_desc(a, b);
+    case Q_NOCASE:
+        return before_nocase(a, b);
+    case Q_NUMERIC:
+        return before_numeric(a, b);
+    case Q_LOCALE:
+    case Q_COLLATE:
+        return before_collate(a, b);
+    default:
+        return before_asc(a, b);
+    }
+}
+
+/* xoshiro256** generator, its state spread from a seed by splitmix64 */
+typedef struct {
+    uint64_t s[4];
+} rng_t;
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static void rng_seed(rng_t *r, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+static inline uint64_t rng_next(rng_t *r)
+{
+    uint64_t result = rotl(r->s[1] * 5, 7) * 9;
+    uint64_t t = r->s[1] << 17;
+    r->s[2] ^= r->s[0];
+    r->s[3] ^= r->s[1];
+    r->s[1] ^= r->s[2];
+    r->s[0] ^= r->s[3];
+    r->s[2] ^= t;
+    r->s[3] = rotl(r->s[3], 45);
+    return result;
+}
+
+/* Uniform integer in [0, range), by Lemire's multiply and reject */
+static inline uint64_t rng_below(rng_t *r, uint64_t range)
+{
+    __uint128_t m = (__uint128_t) rng_next(r) * range;
+    uint64_t low = (uint64_t) m;
+    if (low < range) {
+        uint64_t floor = -range % range;
+        while (low < floor) {
+            m = (__uint128_t) rng_next(r) * range;
+            low = (uint64_t) m;
+        }
+    }
+    return m >> 64;
+}
+
+bool q_shuffle(queue_t *q, uint64_t seed)
+{
+    if (!q)
+        return false;
+    if (q->size < 2)
+        return true;
+
+    if (q->size > SIZE_MAX / sizeof(list_ele_t *))
+        return false;
+    list_ele_t **eles = malloc(q->size * sizeof(list_ele_t *));
+    if (!eles)
+        return false;
+
+    /* Snapshots copy the order they saw, so no failure may follow this */
+    unshare(q);
+    lose_positions(q);
+    if (in_sorted_mode(q))
+        q->index->stale = true;
+
+    size_t n = 0;
+    for (list_ele_t *e = q->head; e; e = e->next)
+        eles[n++] = e;
+
+    /* Fisher-Yates: each element in turn swaps with one not yet placed */
+    rng_t rng;
+    rng_seed(&rng, seed);
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = rng_below(&rng, i + 1);
+        list_ele_t *t = eles[i];
+        eles[i] = eles[j];
+        eles[j] = t;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        eles[i]->prev = i ? eles[i - 1] : NULL;
+        eles[i]->next = i + 1 < n ? eles[i + 1] : NULL;
+    }
+    q->head = eles[0];
+    q->tail = eles[n - 1];
+    free(eles);
+
+    return true;
+}
+
+/*
+ * Switch queue to sorted mode.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_make_sorted(queue_t *q)
+{
+    if (!q)
+        return false;
+
+    if (in_sorted_mode(q))
+        return true;
+
+    release_stale_index(q);
+    if (q->size > 1) {
+        unshare(q);
+        lose_positions(q);
+        adopt_sorted(q, sort_ranked(q->head, q->size));
+    }
+
+    q->index = sl_new(q->head);
+
+    return q->index != NULL;
+}
+
+/*
+ * Return true if q is in sorted mode.
+ */
+bool q_is_sorted(queue_t *q)
+{
+    return q && in_sorted_mode(q);
+}
+
+/*
+ * Attempt to insert element at its ordered position in a sorted queue.
+ * Return true if successful.
+ * Return false if q is NULL, not in sorted mode or could not allocate space.
+ */
+bool q_insert(queue_t *q, char *s)
+{
+    if (!q || !in_sorted_mode(q))
+        return false;
+
+    if (q->limit && !make_room(q, s))
+        return q->policy == Q_DROP_NEWEST;
+
+    unshare(q);
+    list_ele_t *e = new_element(q, s);
+    if (!e)
+        return false;
+    if (q->limit)
+        drop_oldest(q, e);
+
+    tower_t *update[SKIPLIST_MAX_LEVEL];
+    list_ele_t *pred = sl_search(q->index, q->head, e, update);
+    e->prev = pred;
+    if (pred) {
+        e->next = pred->next;
+        pred->next = e;
+    } else {
+        e->next = q->head;
+        q->head = e;
+    }
+    if (e->next)
+        e->next->prev = e;
+    else
+        q->tail = e;
+    increase_size(q, e);
+
+    sl_insert(q->index, e, update);
+    index_element(q, e);
+
+    return true;
+}
+
+/*
+ * Build a hash index over the elements of queue.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_enable_index(queue_t *q)
+{
+    if (!q)
+        return false;
+
+    if (!q->hidx)
+        q->hidx = hi_new(q->head);
+
+    return q->hidx != NULL;
+}
+
+/*
+ * Attach a counting Bloom filter to queue.
+ * Return true if successful.
+ * Return false if q is NULL, fp_rate is out of range or could not allocate
+ * space.
+ */
+bool q_enable_bloom(queue_t *q, double fp_rate)
+{
+    if (!q)
+        return false;
+
+    /* Leave room for the queue to double before the first rebuild */
+    bloom_t *bf = bf_new(q->size * 2, fp_rate);
+    if (!bf)
+        return false;
+
+    for (list_ele_t *e = q->head; e; e = e->next)
+        bf_add(bf, e->value);
+    bf_free(q->bloom);
+    q->bloom = bf;
+
+    return true;
+}
+
+/*
+ * Share one reference-counted copy of every distinct value.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_enable_interning(queue_t *q)
+{
+    if (!q)
+        return false;
+
+    if (q->pool)
+        return true;
+
+    intern_t *pool = in_new();
+    if (!pool)
+        return false;
+
+    /*
+     * Pool every value first, so that failing leaves the queue as it was.
+     * Retired elements are freed through the pool too, so theirs count.
+     */
+    for (list_ele_t *e = q->head; e; e = e->next) {
+        if (!in_acquire(pool, e->value)) {
+            in_free(pool);
+            return false;
+        }
+    }
+    for (list_ele_t *e = q->retired; e; e = e->sib_next) {
+        if (!in_acquire(pool, e->value)) {
+            in_free(pool);
+            return false;
+        }
+    }
+
+    /* The references are taken already, so just trade the private copies */
+    for (list_ele_t *e = q->head; e; e = e->next) {
+        char *shared = in_find(pool, e->value);
+        release_value(q, e);
+        e->value = shared;
+    }
+    for (list_ele_t *e = q->retired; e; e = e->sib_next) {
+        char *shared = in_find(pool, e->value);
+        release_value(q, e);
+        e->value = shared;
+    }
+    q->pool = pool;
+
+    return true;
+}
+
+/*
+ * Build a positional index over the elements of queue.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_enable_positions(queue_t *q)
+{
+    if (!q)
+        return false;
+
+    if (!q->pos)
+        q->pos = pi_new(q->head, q->blobs);
+
+    return q->pos != NULL;
+}
+
+/*
+ * Return the element at position i, counting from 0 at the head.
+ * Return NULL if q is NULL or holds no more than i elements.
+ */
+list_ele_t *q_at(queue_t *q, size_t i)
+{
+    if (!q || i >= q->size)
+        return NULL;
+
+    if (refresh_positions(q))
+        return pi_at(q->pos, q->head, i, NULL);
+
+    /* Without an index, walk in from the nearer end */
+    list_ele_t *e;
+    if (i < q->size / 2) {
+        for (e = q->head; i > 0; i--)
+            e = e->next;
+    } else {
+        for (e = q->tail, i = q->size - 1 - i; i > 0; i--)
+            e = e->prev;
+    }
+
+    return e;
+}
+
+/*
+ * Delete the element at position i and free its storage.
+ * Return false if q is NULL or holds no more than i elements.
+ */
+bool q_delete_at(queue_t *q, size_t i)
+{
+    list_ele_t *e = q_at(q, i);
+    if (!e)
+        return false;
+
+    unshare(q);
+
+    /* The index knows the position, so spare it the guess from e */
+    posidx_t *pi = q->pos;
+    if (has_positions(q)) {
+        pi_remove(pi, q->head, i);
+        q->pos = NULL;
+    }
+    unlink_element(q, e);
+    q->pos = pi;
+    free_element(q, e);
+
+    return true;
+}
+
+/*
+ * Move the first k % size elements behind the others, in O(1) relinking
+ * plus the lookup of the new head.
+ * Return false if q is NULL.
+ * A queue in sorted mode leaves it.
+ */
+bool q_rotate(queue_t *q, size_t k)
+{
+    if (!q)
+        return false;
+    if (q->size < 2 || k % q->size == 0)
+        return true;
+
+    k %= q->size;
+    list_ele_t *first = q_at(q, k);
+
+    unshare(q);
+    if (in_sorted_mode(q))
+        q->index->stale = true;
+    if (has_positions(q))
+        pi_rotate(q->pos, q->head, k, q->size, q->bytes);
+
+    q->tail->next = q->head;
+    q->head->prev = q->tail;
+    q->tail = first->prev;
+    q->tail->next = NULL;
+    q->head = first;
+    q->head->prev = NULL;
+
+    return true;
+}
+
+/*
+ * Split off the elements from position i on into a new queue, which gets a
+ * positional index too if q has one.
+ * Return NULL if q is NULL, holds fewer than i elements, is sorted, indexed,
+ * filtered, interned or snapshotted, would have to give away elements stored
+ * inline, or could not allocate space.  A bounded q keeps its bound, and the
+ * new queue is unbounded.
+ */
+queue_t *q_split(queue_t *q, size_t i)
+{
+    if (!is_plain(q) || i > q->size)
+        return NULL;
+
+    /* A stale index must be whole again before it can be split */
+    if (q->pos && !refresh_positions(q))
+        return NULL;
+
+    list_ele_t *first = q_at(q, i);
+
+    /* Inline elements live inside q, so they cannot move to another queue */
+    size_t tail_bytes = 0;
+    for (list_ele_t *e = first; e && (q->inline_used || !q->pos);
+         e = e->next) {
+        if (is_inline(q, e))
+            return NULL;
+        tail_bytes += value_len(q, e->value) + 1;
+    }
+
+    queue_t *tail = q_new();
+    if (!tail)
+        return NULL;
+    tail->blobs = q->blobs;
+    tail->blob_min = q->blob_min;
+
+    if (q->pos) {
+        tail->pos = pi_split(q->pos, q->head, i, q->size, q->bytes,
+                             &tail_bytes);
+        if (!tail->pos) {
+            q_free(tail);
+            return NULL;
+        }
+    }
+
+    if (first) {
+        tail->head = first;
+        tail->tail = q->tail;
+        q->tail = first->prev;
+        if (q->tail)
+            q->tail->next = NULL;
+        else
+            q->head = NULL;
+        first->prev = NULL;
+    }
+    tail->size = q->size - i;
+    tail->bytes = tail_bytes;
+    q->size = i;
+    q->bytes -= tail_bytes;
+
+    return tail;
+}
+
+/*
+ * Store later values of at least threshold bytes, terminator included, in
+ * region b, or stop if b is NULL.
+ * Return true if successful.
+ * Return false if q is NULL, or still holds values of another region.
+ */
+bool q_use_blobs(queue_t *q, struct blobs *b, size_t threshold)
+{
+    if (!q)
+        return false;
+
+    if (q->blobs && q->blobs != b && (q->head || q->retired)) {
+        for (list_ele_t *e = q->head; e; e = e->next) {
+            if (bl_owns(q->blobs, e->value))
+                return false;
+        }
+        for (list_ele_t *e = q->retired; e; e = e->sib_next) {
+            if (bl_owns(q->blobs, e->value))
+                return false;
+        }
+    }
+    q->blobs = b;
+    q->blob_min = threshold;
+    if (q->pos)
+        q->pos->blobs = b;
+
+    return true;
+}
+
+/*
+ * Return an element whose value equals s, or NULL if there is none.
+ */
+list_ele_t *q_find(queue_t *q, char *s)
+{
+    if (!q || !s)
+        return NULL;
+
+    if (q->bloom && !bf_maybe_contains(q->bloom, s))
+        return NULL;
+
+    if (q->hidx)
+        return hi_find(q->hidx, s);
+
+    for (list_ele_t *e = q->head; e; e = e->next) {
+        if (!strcmp(e->value, s))
+            return e;
+    }
+
+    return NULL;
+}
+
+/*
+ * Return true if some element holds value s.
+ */
+bool q_contains(queue_t *q, char *s)
+{
+    return q_find(q, s) != NULL;
+}
+
+/*
+ * Attempt to remove an element whose value equals s.
+ * Return true if successful.
+ * Return false if q is NULL or no element holds s.
+ */
+bool q_remove_value(queue_t *q, char *s)
+{
+    list_ele_t *e = q_find(q, s);
+    if (!e)
+        return false;
+
+    unshare(q);
+    unlink_element(q, e);
+    free_element(q, e);
+
+    return true;
+}
+
+/* Transient set of elements with distinct values, used by q_dedup */
+typedef struct {
+    hi_entry_t *slots;
+    size_t capacity;
+    size_t count;
+} seen_set_t;
+
+/* Return the slot holding the value of e, or the empty slot where it belongs */
+static hi_entry_t *seen_lookup(seen_set_t *set, list_ele_t *e, uint32_t hash)
+{
+    size_t mask = set->capacity - 1;
+    size_t i = hash & mask;
+    while (set->slots[i].ele) {
+        list_ele_t *other = set->slots[i].ele;
+        if (other == e || other->value == e->value ||
+            (set->slots[i].hash == hash && !strcmp(other->value, e->value)))
+            break;
+        i = (i + 1) & mask;
+    }
+
+    return &set->slots[i];
+}
+
+static bool seen_grow(seen_set_t *set)
+{
+    size_t capacity = set->capacity * 2;
+    hi_entry_t *slots = malloc(capacity * sizeof(hi_entry_t));
+    if (!slots)
+        return false;
+
+    memset(slots, 0, capacity * sizeof(hi_entry_t));
+    for (size_t i = 0; i < set->capacity; i++) {
+        if (!set->slots[i].ele)
+            continue;
+        size_t j = set->slots[i].hash & (capacity - 1);
+        while (slots[j].ele)
+            j = (j + 1) & (capacity - 1);
+        slots[j] = set->slots[i];
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+
+    return true;
+}
+
+/* An element is a duplicate unless the set kept it for its value */
+static bool is_duplicate(list_ele_t *e, void *arg)
+{
+    return seen_lookup(arg, e, hash_str(e->value))->ele != e;
+}
+
+/*
+ * Remove elements whose value already occurs in queue.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_dedup(queue_t *q, bool keep_first)
+{
+    if (!q)
+        return false;
+
+    if (q->size < 2)
+        return true;
+
+    seen_set_t set = {.capacity = 64, .count = 0};
+    set.slots = malloc(set.capacity * sizeof(hi_entry_t));
+    if (!set.slots)
+        return false;
+    memset(set.slots, 0, set.capacity * sizeof(hi_entry_t));
+
+    /*
+     * First pass: remember the element to keep for every value.  Nothing
+     * is changed yet, so running out of memory leaves the queue intact.
+     */
+    list_ele_t *e = keep_first ? q->head : q->tail;
+    while (e) {
+        uint32_t hash = hash_str(e->value);
+        hi_entry_t *slot = seen_lookup(&set, e, hash);
+        if (!slot->ele) {
+            slot->hash = hash;
+            slot->ele = e;
+            set.count++;
+            if (set.count * 2 > set.capacity && !seen_grow(&set)) {
+                free(set.slots);
+                return false;
+            }
+        }
+        e = keep_first ? e->next : e->prev;
+    }
+
+    /*
+     * Second pass: unlink the rest, collecting them to be freed in bulk.
+     * Towers of sorted mode are pruned all at once afterwards, as removing
+     * them one by one would cost a search for each.
+     */
+    unshare(q);
+    skiplist_t *sl = q->index;
+    q->index = NULL;
+
+    list_ele_t *dropped = NULL;
+    e = q->head;
+    while (e) {
+        list_ele_t *next = e->next;
+        if (is_duplicate(e, &set)) {
+            unlink_element(q, e);
+            e->next = dropped;
+            dropped = e;
+        }
+        e = next;
+    }
+
+    if (sl && !sl->stale)
+        sl_prune(sl, is_duplicate, &set);
+    q->index = sl;
+    free(set.slots);
+
+    while (dropped) {
+        list_ele_t *old = dropped;
+        dropped = dropped->next;
+        free_element(q, old);
+    }
+
+    return true;
+}
+
+/*
+ * Take a snapshot of queue in O(1) time.
+ * Return NULL if q is NULL or could not allocate space.
+ */
+snapshot_t *q_snapshot(queue_t *q)
+{
+    if (!q)
+        return NULL;
+
+    snapshot_t *snap = malloc(sizeof(snapshot_t));
+    if (!snap)
+        return NULL;
+
+    snap->head = q->head;
+    snap->size = q->size;
+    snap->lost = false;
+    snap->copy = NULL;
+    snap->source = q;
+    snap->next = q->snaps;
+    q->snaps = snap;
+
+    return snap;
+}
+
+/* Free a snapshot, and any elements it alone kept alive */
+void q_snapshot_free(snapshot_t *snap)
+{
+    if (!snap)
+        return;
+
+    queue_t *q = snap->source;
+    if (q) {
+        snapshot_t **link = &q->snaps;
+        while (*link != snap)
+            link = &(*link)->next;
+        *link = snap->next;
+        if (!q->snaps) {
+            free_retired(q);
+            if (q->orphaned)
+                q_free(q);
+        }
+    }
+
+    q_free(snap->copy);
+    free(snap);
 }
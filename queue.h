@@ -5,30 +5,110 @@
  * This program implements a queue supporting both FIFO and LIFO
  * operations.
  *
- * It uses a singly-linked list to represent the set of queue elements
+ * It uses a doubly-linked list to represent the set of queue elements, so
+ * that an element found through the hash index can be unlinked in O(1).
  */
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Data structure declarations */
 
-/* Linked list element (You shouldn't need to change this) */
+/* Linked list element */
 typedef struct ELE {
     /* Pointer to array holding string.
      * This array needs to be explicitly allocated and freed
      */
     char *value;
     struct ELE *next;
+    struct ELE *prev;
+    /*
+     * Ring of elements holding the same value, kept by the hash index.
+     * Once removed while snapshots may still see it, an element is chained
+     * to the other retired ones through sib_next instead.
+     */
+    struct ELE *sib_next;
+    struct ELE *sib_prev;
 } list_ele_t;
 
+struct blobs;
+struct skiplist;
+struct posidx;
+struct hashidx;
+struct snapshot;
+
+/* What an insertion into a full bounded queue does */
+typedef enum {
+    Q_REJECT,      /* Fail, counting a rejection */
+    Q_BLOCK,       /* Fail like Q_REJECT; blocking queues wait for room */
+    Q_DROP_OLDEST, /* Remove elements from the head until the new one fits */
+    Q_DROP_NEWEST, /* Succeed, but discard the new element */
+} q_policy_t;
+
+/* Orders q_sort_by can sort in */
+typedef enum {
+    Q_ASC,     /* Ascending, by strcmp */
+    Q_DESC,    /* Descending, by strcmp */
+    Q_NOCASE,  /* Ascending, ignoring case */
+    Q_NUMERIC, /* Ascending by leading number, as strtod reads it */
+    Q_LOCALE,  /* Ascending by the collation of the current locale */
+    Q_COLLATE, /* Same as Q_LOCALE, but allocating nothing */
+} q_order_t;
+
+/*
+ * Room for the first few elements inside queue_t itself, each with a short
+ * string, so that a tiny queue costs a single allocation.  Longer strings,
+ * interned values and further elements spill to the heap.
+ */
+#define Q_INLINE 4
+#define Q_INLINE_LEN 24
+
+typedef struct {
+    list_ele_t ele;
+    char value[Q_INLINE_LEN];
+} q_inline_t;
+
 /* Queue structure */
 typedef struct {
     list_ele_t *head; /* Linked list of elements */
     list_ele_t *tail;
-    int size;
+    size_t size;
+    size_t bytes; /* Total length of the strings, terminators included */
+    size_t limit; /* Capacity in elements or bytes, 0 if unbounded */
+    bool limit_bytes;
+    q_policy_t policy;
+    long rejected; /* Insertions refused for lack of room */
+    long dropped;  /* Elements discarded to respect the capacity */
+    struct skiplist *index; /* Skip-list index, used in sorted mode */
+    struct hashidx *hidx;   /* Optional hash index from value to element */
+    struct posidx *pos;     /* Optional index from position to element */
+    struct bloom *bloom;    /* Optional summary of the values present */
+    struct intern *pool;    /* Optional pool sharing equal values */
+    struct blobs *blobs;    /* Optional region for large values */
+    size_t blob_min;        /* Shortest value stored there, with terminator */
+    struct snapshot *snaps; /* Live snapshots sharing elements */
+    list_ele_t *retired;    /* Removed elements snapshots may still see */
+    bool orphaned;          /* Freed, but left to its last snapshot */
+    unsigned inline_used;   /* Bit i set while inlined[i] is taken */
+    q_inline_t inlined[Q_INLINE];
 } queue_t;
 
+/*
+ * Read-only view of a queue as it was when taken.
+ * It shares the elements of its source until the source relinks them, and
+ * only then gets a private copy.  To read it, walk size elements from head
+ * through next: the links past the last one belong to the source.
+ */
+typedef struct snapshot {
+    list_ele_t *head;
+    size_t size;
+    bool lost;             /* Set if the private copy could not be made */
+    queue_t *copy;         /* Private copy, once made */
+    queue_t *source;       /* Queue still sharing elements, or NULL */
+    struct snapshot *next; /* Next live snapshot of the same source */
+} snapshot_t;
+
 /* Operations on queue */
 
 /*
@@ -49,6 +129,8 @@ void q_free(queue_t *q);
  * Return false if q is NULL or could not allocate space.
  * Argument s points to the string to be stored.
  * The function must explicitly allocate space and copy the string into it.
+ * In sorted mode the element goes to its ordered position instead.
+ * A bounded queue that is full applies its overflow policy first.
  */
 bool q_insert_head(queue_t *q, char *s);
 
@@ -58,9 +140,51 @@ bool q_insert_head(queue_t *q, char *s);
  * Return false if q is NULL or could not allocate space.
  * Argument s points to the string to be stored.
  * The function must explicitly allocate space and copy the string into it.
+ * In sorted mode the element goes to its ordered position instead.
+ * A bounded queue that is full applies its overflow policy first.
  */
 bool q_insert_tail(queue_t *q, char *s);
 
+/*
+ * Switch queue to sorted mode.
+ * The elements are sorted once, then a skip-list index is built over them so
+ * that later insertions find their ordered position in O(log n) expected time.
+ * Removing from the head stays O(1).  Reversing the queue leaves sorted mode.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_make_sorted(queue_t *q);
+
+/*
+ * Return true if q is in sorted mode.
+ */
+bool q_is_sorted(queue_t *q);
+
+/*
+ * Attempt to insert element at its ordered position in a sorted queue.
+ * Equal values are ranked by the address of their elements, so that the one
+ * removed by value is found in O(log n) expected time, however many there are.
+ * Return true if successful.
+ * Return false if q is NULL, not in sorted mode or could not allocate space.
+ * Argument s points to the string to be stored.
+ */
+bool q_insert(queue_t *q, char *s);
+
+/*
+ * Bound queue to limit elements, or to limit bytes of strings (terminators
+ * included) if bytes is true, with policy deciding what an insertion that
+ * does not fit does.  A limit of 0 makes the queue unbounded again.
+ * Elements beyond a lowered limit stay until removed.
+ * Return false if q is NULL.
+ */
+bool q_set_capacity(queue_t *q, size_t limit, bool bytes, q_policy_t policy);
+
+/*
+ * Return true if s can be inserted into queue without exceeding its
+ * capacity, whatever the policy.
+ */
+bool q_fits(queue_t *q, char *s);
+
 /*
  * Attempt to remove element from head of queue.
  * Return true if successful.
@@ -71,11 +195,47 @@ bool q_insert_tail(queue_t *q, char *s);
  */
 bool q_remove_head(queue_t *q, char *sp, size_t bufsize);
 
+/*
+ * The next primitives relink elements in O(1) instead of copying strings.
+ * They keep the hash index and Bloom filter up to date, but do not apply
+ * the capacity, and refuse queues in sorted mode or with interned values.
+ * They return false if a queue is NULL or refused.
+ */
+
+/*
+ * Link element e at head (or tail) of queue.  Its value must have been
+ * allocated the way the queue allocates its own, since the queue owns both
+ * from then on.  The caller may embed e at the start of a larger structure.
+ * Return false as well if could not allocate space.
+ */
+bool q_link_head(queue_t *q, list_ele_t *e);
+bool q_link_tail(queue_t *q, list_ele_t *e);
+
+/*
+ * Take element e out of queue without freeing it.  The caller owns e and
+ * its value again, which goes back with bl_release if the blob region of
+ * the queue holds it.  Refused for an element stored inside the queue.
+ */
+bool q_unlink(queue_t *q, list_ele_t *e);
+
+/*
+ * Move element e of queue to its head.
+ */
+bool q_move_head(queue_t *q, list_ele_t *e);
+
+/*
+ * Move every element of src to tail of dst, leaving src empty.  Neither
+ * queue may have a hash index, Bloom filter or snapshots either, src may
+ * hold no element stored inside it, and a blob region of src must be that
+ * of dst too.
+ */
+bool q_splice_tail(queue_t *dst, queue_t *src);
+
 /*
  * Return number of elements in queue.
  * Return 0 if q is NULL or empty
  */
-int q_size(queue_t *q);
+size_t q_size(queue_t *q);
 
 /*
  * Reverse elements in queue
@@ -83,14 +243,177 @@ int q_size(queue_t *q);
  * This function should not allocate or free any list elements
  * (e.g., by calling q_insert_head, q_insert_tail, or q_remove_head).
  * It should rearrange the existing ones.
+ * A queue in sorted mode leaves it.
  */
 void q_reverse(queue_t *q);
 
 /*
  * Sort elements of queue in ascending order
  * No effect if q is NULL or empty. In addition, if q has only one
- * element, do nothing.
+ * element, do nothing.  A queue in sorted mode is sorted already.
  */
 void q_sort(queue_t *q);
 
+/*
+ * Sort elements of queue in the given order, keeping equal elements in
+ * their relative order.  Each order has a sort of its own, with the
+ * comparison inlined.  Same special cases as q_sort; a queue in sorted
+ * mode sorted in any order but Q_ASC leaves it.
+ * Q_LOCALE computes a collation key per element once and compares those,
+ * in scratch memory it frees before returning; if that cannot be
+ * allocated, it calls strcoll in every comparison like Q_COLLATE.
+ */
+void q_sort_by(queue_t *q, q_order_t order);
+
+/*
+ * Return true if element a may come before element b in the given order.
+ */
+bool q_before(q_order_t order, list_ele_t *a, list_ele_t *b);
+
+/*
+ * Put elements of queue in a random order, each of the n! orders equally
+ * likely, drawn from a generator seeded with seed: the same seed gives the
+ * same order for the same queue.  Takes O(n) time and n pointers of
+ * scratch memory, freed before returning.  A queue in sorted mode leaves
+ * it.
+ * Return true if successful, or if q holds fewer than two elements.
+ * Return false if q is NULL or could not allocate space, leaving the
+ * order unchanged.
+ */
+bool q_shuffle(queue_t *q, uint64_t seed);
+
+/*
+ * Build a hash index over the elements of queue, so that q_find and
+ * q_remove_value take O(1) expected time.  Every later operation keeps the
+ * index up to date.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_enable_index(queue_t *q);
+
+/*
+ * Attach a counting Bloom filter to queue, so that q_find and q_contains
+ * settle most absent values in O(1) without scanning.  fp_rate is the
+ * fraction of absent values let through to the scan; the filter grows with
+ * the queue to keep it.  Calling it again retunes the filter.
+ * Return true if successful.
+ * Return false if q is NULL, fp_rate is not in (0, 1) or could not allocate
+ * space, in which case any previous filter stays.
+ */
+bool q_enable_bloom(queue_t *q, double fp_rate);
+
+/*
+ * Make elements holding equal values share one reference-counted copy, both
+ * for the current elements and every later insertion.  Inserting a value
+ * already present then copies nothing, and removing it only drops a count.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space, in which case the
+ * queue is left unchanged.
+ */
+bool q_enable_interning(queue_t *q);
+
+/*
+ * Build a positional index over the elements of queue, so that q_at,
+ * q_delete_at, q_rotate and q_split take O(log n) expected time instead of
+ * walking the list.  Inserting at either end and removing from the head
+ * keep it up to date in O(log n); any other change to the order leaves it
+ * to be rebuilt by the next positional operation.  Later elements are
+ * never stored inside the queue.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space.
+ */
+bool q_enable_positions(queue_t *q);
+
+/*
+ * Return the element at position i, counting from 0 at the head.
+ * Return NULL if q is NULL or holds no more than i elements.
+ */
+list_ele_t *q_at(queue_t *q, size_t i);
+
+/*
+ * Attempt to remove the element at position i.
+ * Return false if q is NULL or holds no more than i elements.
+ */
+bool q_delete_at(queue_t *q, size_t i);
+
+/*
+ * Move the first k elements of queue, modulo its size, behind the others.
+ * A queue in sorted mode leaves it.
+ * Return false if q is NULL.
+ */
+bool q_rotate(queue_t *q, size_t k);
+
+/*
+ * Move the elements from position i on into a new queue, which gets a
+ * positional index of its own if q had one, and shares its blob region.
+ * q may have no hash index, Bloom filter, pool or snapshots, nor be in
+ * sorted mode, and none of the elements moving may be stored inside it.
+ * A bounded q keeps its bound; the new queue is unbounded.
+ * Return the new queue, or NULL if q is NULL or refused, i exceeds its
+ * size or could not allocate space.
+ */
+queue_t *q_split(queue_t *q, size_t i);
+
+/*
+ * Store later values of at least threshold bytes, terminator included, in
+ * the blob region b instead of the heap, or stop if b is NULL.  Their
+ * elements keep a plain pointer into the region, whose header holds the
+ * length, so moving, splicing and removing them never copies or measures
+ * the whole value.  Several queues may share a region, which must outlive
+ * them.  A value the region has no room for goes to the heap, and
+ * interned values stay in the pool.
+ * Return true if successful.
+ * Return false if q is NULL, or still holds values of another region.
+ */
+bool q_use_blobs(queue_t *q, struct blobs *b, size_t threshold);
+
+/*
+ * Return an element whose value equals s, or NULL if there is none.
+ * Without a hash index this scans the queue, unless the Bloom filter rules
+ * s out.
+ */
+list_ele_t *q_find(queue_t *q, char *s);
+
+/*
+ * Return true if some element holds value s.
+ */
+bool q_contains(queue_t *q, char *s);
+
+/*
+ * Attempt to remove an element whose value equals s.
+ * Return true if successful.
+ * Return false if q is NULL or no element holds s.
+ * The space used by the list element and the string should be freed.
+ */
+bool q_remove_value(queue_t *q, char *s);
+
+/*
+ * Remove elements whose value already occurs in queue, in a single O(n) pass
+ * that keeps the order of the remaining elements.
+ * If keep_first is true the first occurrence of every value stays,
+ * otherwise the last one does.
+ * Return true if successful.
+ * Return false if q is NULL or could not allocate space, in which case the
+ * queue is left unchanged.
+ */
+bool q_dedup(queue_t *q, bool keep_first);
+
+/*
+ * Take a snapshot of queue in O(1) time.
+ * Inserting at either end and removing from the head leave snapshots shared;
+ * elements removed meanwhile are freed with the last snapshot instead, and
+ * so is the whole queue if q_free comes first.  Any other change to the
+ * queue first gives every live snapshot a private copy, so q_reverse and
+ * q_sort then allocate.  A snapshot whose copy cannot be allocated is lost
+ * and reads as empty.
+ * Return NULL if q is NULL or could not allocate space.
+ */
+snapshot_t *q_snapshot(queue_t *q);
+
+/*
+ * Free a snapshot, and any elements it alone kept alive.
+ * No effect if snap is NULL
+ */
+void q_snapshot_free(snapshot_t *snap);
+
 #endif /* LAB0_QUEUE_H */
@@ -35,7 +35,39 @@ class Tracer:
         14: "trace-14-perf",
         15: "trace-15-perf",
         16: "trace-16-perf",
-        17: "trace-17-complexity"
+        17: "trace-17-complexity",
+        18: "trace-18-sorted",
+        19: "trace-19-pqueue",
+        20: "trace-20-pq-complexity",
+        21: "trace-21-index",
+        22: "trace-22-index-perf",
+        23: "trace-23-dedup",
+        24: "trace-24-dedup-perf",
+        25: "trace-25-bloom",
+        26: "trace-26-bloom-perf",
+        27: "trace-27-intern",
+        28: "trace-28-intern-perf",
+        29: "trace-29-snapshot",
+        30: "trace-30-snapshot-perf",
+        31: "trace-31-bqueue",
+        32: "trace-32-lfqueue",
+        33: "trace-33-spsc",
+        34: "trace-34-tlqueue",
+        35: "trace-35-wsdeque",
+        36: "trace-36-mqueue",
+        37: "trace-37-bounded",
+        38: "trace-38-twheel",
+        39: "trace-39-twheel-perf",
+        40: "trace-40-lru",
+        41: "trace-41-inline",
+        42: "trace-42-stress",
+        43: "trace-43-tqueue",
+        44: "trace-44-sortby",
+        45: "trace-45-locale",
+        46: "trace-46-shuffle",
+        47: "trace-47-positions",
+        48: "trace-48-blobs",
+        49: "trace-49-frozen"
     }
 
     traceProbs = {
@@ -55,10 +87,42 @@ class Tracer:
         14: "Trace-14",
         15: "Trace-15",
         16: "Trace-16",
-        17: "Trace-17"
+        17: "Trace-17",
+        18: "Trace-18",
+        19: "Trace-19",
+        20: "Trace-20",
+        21: "Trace-21",
+        22: "Trace-22",
+        23: "Trace-23",
+        24: "Trace-24",
+        25: "Trace-25",
+        26: "Trace-26",
+        27: "Trace-27",
+        28: "Trace-28",
+        29: "Trace-29",
+        30: "Trace-30",
+        31: "Trace-31",
+        32: "Trace-32",
+        33: "Trace-33",
+        34: "Trace-34",
+        35: "Trace-35",
+        36: "Trace-36",
+        37: "Trace-37",
+        38: "Trace-38",
+        39: "Trace-39",
+        40: "Trace-40",
+        41: "Trace-41",
+        42: "Trace-42",
+        43: "Trace-43",
+        44: "Trace-44",
+        45: "Trace-45",
+        46: "Trace-46",
+        47: "Trace-47",
+        48: "Trace-48",
+        49: "Trace-49"
     }
 
-    maxScores = [0, 6, 6, 6, 6, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 5]
+    maxScores = [0, 6, 6, 6, 6, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 5, 6, 6, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6]
 
     RED = '\033[91m'
     GREEN = '\033[92m'
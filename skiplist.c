@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "skiplist.h"
+
+/* Draw tower heights from a geometric distribution with p = 1/4 */
+static int random_height(skiplist_t *sl)
+{
+    /* xorshift32 */
+    uint32_t x = sl->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sl->seed = x;
+
+    int h = 0;
+    while ((x & 3) == 0 && h < SKIPLIST_MAX_LEVEL) {
+        h++;
+        x >>= 2;
+    }
+    return h;
+}
+
+static tower_t *create_tower(list_ele_t *e, int height)
+{
+    tower_t *t = malloc(sizeof(tower_t) + height * sizeof(tower_t *));
+    if (!t)
+        return NULL;
+
+    t->ele = e;
+    t->height = height;
+    for (int l = 0; l < height; l++)
+        t->next[l] = NULL;
+
+    return t;
+}
+
+skiplist_t *sl_new(list_ele_t *head)
+{
+    skiplist_t *sl = malloc(sizeof(skiplist_t));
+    if (!sl)
+        return NULL;
+
+    sl->stale = false;
+    sl->level = 0;
+    sl->seed = 2463534242U;
+    for (int l = 0; l < SKIPLIST_MAX_LEVEL; l++)
+        sl->head[l] = NULL;
+
+    /* Towers are appended level by level, so remember the last of each */
+    tower_t *last[SKIPLIST_MAX_LEVEL] = {NULL};
+    for (list_ele_t *e = head; e; e = e->next) {
+        int h = random_height(sl);
+        if (h == 0)
+            continue;
+
+        tower_t *t = create_tower(e, h);
+        if (!t)
+            continue;
+
+        for (int l = 0; l < h; l++) {
+            if (last[l])
+                last[l]->next[l] = t;
+            else
+                sl->head[l] = t;
+            last[l] = t;
+        }
+        if (h > sl->level)
+            sl->level = h;
+    }
+
+    return sl;
+}
+
+void sl_free(skiplist_t *sl)
+{
+    if (!sl)
+        return;
+
+    /* Every tower takes part in the lowest level */
+    tower_t *t = sl->head[0];
+    while (t) {
+        tower_t *old = t;
+        t = t->next[0];
+        free(old);
+    }
+
+    free(sl);
+}
+
+list_ele_t *sl_search(skiplist_t *sl,
+                      list_ele_t *head,
+                      list_ele_t *e,
+                      tower_t **update)
+{
+    /* NULL stands for the header on every level */
+    tower_t *t = NULL;
+    for (int l = sl->level - 1; l >= 0; l--) {
+        tower_t *next = t ? t->next[l] : sl->head[l];
+        while (next && sl_compare(next->ele, e) < 0) {
+            t = next;
+            next = t->next[l];
+        }
+        update[l] = t;
+    }
+
+    /* Finish the search on the chain itself */
+    list_ele_t *pred = t ? t->ele : NULL;
+    list_ele_t *next = pred ? pred->next : head;
+    while (next && sl_compare(next, e) < 0) {
+        pred = next;
+        next = next->next;
+    }
+
+    return pred;
+}
+
+void sl_insert(skiplist_t *sl, list_ele_t *e, tower_t **update)
+{
+    int h = random_height(sl);
+    if (h == 0)
+        return;
+
+    /* A missing tower only slows searches down, so failure is harmless */
+    tower_t *t = create_tower(e, h);
+    if (!t)
+        return;
+
+    for (int l = sl->level; l < h; l++)
+        update[l] = NULL;
+    if (h > sl->level)
+        sl->level = h;
+
+    for (int l = 0; l < h; l++) {
+        if (update[l]) {
+            t->next[l] = update[l]->next[l];
+            update[l]->next[l] = t;
+        } else {
+            t->next[l] = sl->head[l];
+            sl->head[l] = t;
+        }
+    }
+}
+
+void sl_remove_head(skiplist_t *sl, list_ele_t *e)
+{
+    /* The head is the smallest value, so its tower leads every level */
+    tower_t *t = sl->head[0];
+    if (!t || t->ele != e)
+        return;
+
+    for (int l = 0; l < t->height; l++)
+        sl->head[l] = t->next[l];
+    while (sl->level > 0 && !sl->head[sl->level - 1])
+        sl->level--;
+
+    free(t);
+}
+
+void sl_remove(skiplist_t *sl, list_ele_t *e)
+{
+    tower_t *found = NULL;
+    tower_t *t = NULL;
+    for (int l = sl->level - 1; l >= 0; l--) {
+        tower_t *next = t ? t->next[l] : sl->head[l];
+        while (next && sl_compare(next->ele, e) < 0) {
+            t = next;
+            next = t->next[l];
+        }
+        if (!next || next->ele != e)
+            continue;
+
+        found = next;
+        if (t)
+            t->next[l] = found->next[l];
+        else
+            sl->head[l] = found->next[l];
+    }
+
+    if (!found)
+        return;
+
+    while (sl->level > 0 && !sl->head[sl->level - 1])
+        sl->level--;
+    free(found);
+}
+
+void sl_prune(skiplist_t *sl,
+              bool (*dropped)(list_ele_t *e, void *arg),
+              void *arg)
+{
+    /* Unlink from the upper levels first, then free on the lowest one */
+    for (int l = sl->level - 1; l >= 0; l--) {
+        tower_t **link = &sl->head[l];
+        while (*link) {
+            tower_t *t = *link;
+            if (!dropped(t->ele, arg)) {
+                link = &t->next[l];
+                continue;
+            }
+
+            *link = t->next[l];
+            if (l == 0)
+                free(t);
+        }
+    }
+
+    while (sl->level > 0 && !sl->head[sl->level - 1])
+        sl->level--;
+}
@@ -0,0 +1,92 @@
+#ifndef LAB0_SKIPLIST_H
+#define LAB0_SKIPLIST_H
+
+/*
+ * Skip-list index layered over the list_ele_t chain of a sorted queue.
+ *
+ * Level 0 of the skip list is the queue's own linked list.  An element that
+ * is promoted to higher levels gets a separately allocated tower holding one
+ * forward pointer per extra level.  Since the chain alone is a valid (if
+ * slow) level 0, a tower that could not be allocated only makes searches a
+ * little longer; it never makes the index wrong.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "queue.h"
+
+/* Number of levels above the chain.  With p = 1/4 this covers 4^16 elements */
+#define SKIPLIST_MAX_LEVEL 16
+
+typedef struct TOWER {
+    list_ele_t *ele; /* Element promoted by this tower */
+    int height;      /* Number of levels above the chain */
+    struct TOWER *next[];
+} tower_t;
+
+typedef struct skiplist {
+    /* Set when the chain is no longer sorted and the towers are dead weight */
+    bool stale;
+    int level; /* Highest level in use */
+    uint32_t seed;
+    tower_t *head[SKIPLIST_MAX_LEVEL];
+} skiplist_t;
+
+/*
+ * Order of the elements of a sorted queue: by value, and equal values by
+ * element address, so that the tower of any element can be found in
+ * O(log n) however many share its value.
+ */
+static inline int sl_compare(const list_ele_t *a, const list_ele_t *b)
+{
+    int c = a->value == b->value ? 0 : strcmp(a->value, b->value);
+    if (c)
+        return c;
+    return ((uintptr_t) a > (uintptr_t) b) - ((uintptr_t) a < (uintptr_t) b);
+}
+
+/*
+ * Create an index for the chain starting at head, sorted by sl_compare.
+ * Return NULL if could not allocate space.
+ */
+skiplist_t *sl_new(list_ele_t *head);
+
+/* Free the index and all of its towers.  The chain is left untouched */
+void sl_free(skiplist_t *sl);
+
+/*
+ * Find the last element ordered before e, which is not linked yet.  Return
+ * NULL if e belongs at the head.  update receives the last tower visited on
+ * every level, which is needed by sl_insert.
+ */
+list_ele_t *sl_search(skiplist_t *sl,
+                      list_ele_t *head,
+                      list_ele_t *e,
+                      tower_t **update);
+
+/*
+ * Promote the freshly linked element e, using the update vector filled in by
+ * the sl_search call that located it.
+ */
+void sl_insert(skiplist_t *sl, list_ele_t *e, tower_t **update);
+
+/* Drop the tower of e, which is about to be removed from the head */
+void sl_remove_head(skiplist_t *sl, list_ele_t *e);
+
+/*
+ * Drop the tower of e, which is about to be removed from anywhere in the
+ * chain, in O(log n) expected time.
+ */
+void sl_remove(skiplist_t *sl, list_ele_t *e);
+
+/*
+ * Drop the towers of every element for which dropped(e, arg) holds, in one
+ * pass over the index.  The elements must still be allocated.
+ */
+void sl_prune(skiplist_t *sl,
+              bool (*dropped)(list_ele_t *e, void *arg),
+              void *arg);
+
+#endif /* LAB0_SKIPLIST_H */
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "spsc.h"
+
+/*
+ * An index is published with a release store after the slots it covers
+ * were written or read, and picked up by the other thread with an acquire
+ * load before it touches them.
+ */
+#define PUBLISH(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define OBSERVE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+
+/******** Utility Zone ********/
+
+/* Producer: number of free slots, at least want if possible */
+static size_t room(spsc_t *r, size_t want)
+{
+    size_t capacity = r->mask + 1;
+    size_t free_slots = capacity - (r->tail - r->head_cache);
+    if (free_slots >= want)
+        return free_slots;
+
+    /* Only look at the consumer's line when the cached view falls short */
+    r->head_cache = OBSERVE(&r->head);
+    return capacity - (r->tail - r->head_cache);
+}
+
+/* Consumer: number of filled slots, at least want if possible */
+static size_t ready(spsc_t *r, size_t want)
+{
+    size_t filled = r->tail_cache - r->head;
+    if (filled >= want)
+        return filled;
+
+    r->tail_cache = OBSERVE(&r->tail);
+    return r->tail_cache - r->head;
+}
+
+/******** End of Utility Zone ********/
+
+spsc_t *spsc_new(size_t capacity)
+{
+    /* Rounding up to a power of two may double it */
+    if (capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(char *))
+        return NULL;
+
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    spsc_t *r = malloc(sizeof(spsc_t));
+    if (!r)
+        return NULL;
+
+    r->slots = malloc(size * sizeof(char *));
+    if (!r->slots) {
+        free(r);
+        return NULL;
+    }
+    r->mask = size - 1;
+    r->head = 0;
+    r->tail_cache = 0;
+    r->tail = 0;
+    r->head_cache = 0;
+
+    return r;
+}
+
+void spsc_free(spsc_t *r)
+{
+    if (!r)
+        return;
+
+    for (size_t i = r->head; i != r->tail; i++)
+        free(r->slots[i & r->mask]);
+    free(r->slots);
+    free(r);
+}
+
+bool spsc_push(spsc_t *r, char *val)
+{
+    if (!room(r, 1))
+        return false;
+
+    r->slots[r->tail & r->mask] = val;
+    PUBLISH(&r->tail, r->tail + 1);
+
+    return true;
+}
+
+int spsc_push_batch(spsc_t *r, char **vals, int n)
+{
+    if (n <= 0)
+        return 0;
+
+    size_t cnt = room(r, n);
+    if (cnt > (size_t) n)
+        cnt = n;
+
+    for (size_t i = 0; i < cnt; i++)
+        r->slots[(r->tail + i) & r->mask] = vals[i];
+    PUBLISH(&r->tail, r->tail + cnt);
+
+    return cnt;
+}
+
+char *spsc_pop(spsc_t *r)
+{
+    if (!ready(r, 1))
+        return NULL;
+
+    char *val = r->slots[r->head & r->mask];
+    PUBLISH(&r->head, r->head + 1);
+
+    return val;
+}
+
+int spsc_pop_batch(spsc_t *r, char **vals, int n)
+{
+    if (n <= 0)
+        return 0;
+
+    size_t cnt = ready(r, n);
+    if (cnt > (size_t) n)
+        cnt = n;
+
+    for (size_t i = 0; i < cnt; i++)
+        vals[i] = r->slots[(r->head + i) & r->mask];
+    PUBLISH(&r->head, r->head + cnt);
+
+    return cnt;
+}
+
+bool spsc_insert_tail(spsc_t *r, char *s)
+{
+    /* Check first, so that a full ring costs no allocation */
+    if (!room(r, 1))
+        return false;
+
+    char *val = strdup(s);
+    if (!val)
+        return false;
+
+    return spsc_push(r, val);
+}
+
+bool spsc_remove_head(spsc_t *r, char *sp, size_t bufsize)
+{
+    char *val = spsc_pop(r);
+    if (!val)
+        return false;
+
+    if (sp) {
+        strncpy(sp, val, bufsize - 1);
+        sp[bufsize - 1] = '\0';
+    }
+    free(val);
+
+    return true;
+}
+
+size_t spsc_size(spsc_t *r)
+{
+    if (!r)
+        return 0;
+
+    /* Head first: the tail can only get further ahead of it meanwhile */
+    size_t head = OBSERVE(&r->head);
+    return OBSERVE(&r->tail) - head;
+}
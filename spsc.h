@@ -0,0 +1,103 @@
+#ifndef LAB0_SPSC_H
+#define LAB0_SPSC_H
+
+/*
+ * Bounded ring of strings between exactly one producer thread and exactly
+ * one consumer thread.
+ *
+ * The producer only ever writes the tail index and the consumer only the
+ * head index, so neither needs a lock or a read-modify-write instruction:
+ * every operation completes in a bounded number of steps.  Each index sits
+ * on its own cache line together with its owner's cached copy of the
+ * other index, which is only refreshed when the ring looks full (to the
+ * producer) or empty (to the consumer).  In the steady state the two
+ * threads therefore touch each other's line once per lap rather than once
+ * per element, and batch operations publish many elements with one store.
+ *
+ * The ring owns the strings it holds, as queue_t does.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cacheline.h"
+
+typedef struct {
+    /* Written by the consumer */
+    size_t head;       /* Next slot to read */
+    size_t tail_cache; /* Tail as last seen by the consumer */
+    CACHE_PAD(pad0, 2 * sizeof(size_t));
+
+    /* Written by the producer */
+    size_t tail;       /* Next slot to write */
+    size_t head_cache; /* Head as last seen by the producer */
+    CACHE_PAD(pad1, 2 * sizeof(size_t));
+
+    /* Read-only once created */
+    size_t mask; /* Capacity minus one, the capacity being a power of two */
+    char **slots;
+} spsc_t;
+
+/*
+ * Create empty ring holding at least capacity strings.
+ * Return NULL if capacity is 0 or too large, or could not allocate space.
+ */
+spsc_t *spsc_new(size_t capacity);
+
+/*
+ * Free ALL storage used by ring, including the strings still in it.
+ * No thread may be using it.  No effect if r is NULL
+ */
+void spsc_free(spsc_t *r);
+
+/*
+ * Producer: hand string val over to the ring, without copying it.
+ * Return false if the ring is full.
+ */
+bool spsc_push(spsc_t *r, char *val);
+
+/*
+ * Producer: hand over up to n strings of vals, publishing them at once.
+ * Return number of strings handed over, which is less than n if the ring
+ * fills up.
+ */
+int spsc_push_batch(spsc_t *r, char **vals, int n);
+
+/*
+ * Consumer: take the oldest string out of the ring.  The caller becomes
+ * responsible for freeing it.
+ * Return NULL if the ring is empty.
+ */
+char *spsc_pop(spsc_t *r);
+
+/*
+ * Consumer: take up to n of the oldest strings out of the ring into vals,
+ * releasing their slots at once.
+ * Return number of strings taken.
+ */
+int spsc_pop_batch(spsc_t *r, char **vals, int n);
+
+/*
+ * Producer: attempt to insert a copy of s at tail of ring.
+ * Return true if successful.
+ * Return false if the ring is full or could not allocate space.
+ */
+bool spsc_insert_tail(spsc_t *r, char *s);
+
+/*
+ * Consumer: attempt to remove element from head of ring.
+ * Return true if successful.
+ * Return false if the ring is empty.
+ * If sp is non-NULL and an element is removed, copy the removed string to *sp
+ * (up to a maximum of bufsize-1 characters, plus a null terminator.)
+ * The space used by the string is freed.
+ */
+bool spsc_remove_head(spsc_t *r, char *sp, size_t bufsize);
+
+/*
+ * Return number of strings in ring.  Only exact when neither thread is
+ * running, otherwise a snapshot that may already be stale.
+ */
+size_t spsc_size(spsc_t *r);
+
+#endif /* LAB0_SPSC_H */
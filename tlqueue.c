@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "tlqueue.h"
+
+/*
+ * With the queue empty, the dummy's next link is written under the tail
+ * lock and read under the head lock, so it is accessed atomically.
+ */
+#define LINK(e, v) __atomic_store_n(&(e)->next, v, __ATOMIC_RELEASE)
+#define NEXT(e) __atomic_load_n(&(e)->next, __ATOMIC_ACQUIRE)
+
+/******** Utility Zone ********/
+
+static list_ele_t *create_element(char *s)
+{
+    list_ele_t *e = malloc(sizeof(list_ele_t));
+    if (!e)
+        return NULL;
+
+    e->value = NULL;
+    if (s) {
+        e->value = strdup(s);
+        if (!e->value) {
+            free(e);
+            return NULL;
+        }
+    }
+    e->next = NULL;
+    e->prev = NULL;
+    e->sib_next = NULL;
+    e->sib_prev = NULL;
+
+    return e;
+}
+
+/******** End of Utility Zone ********/
+
+tlqueue_t *tlq_new()
+{
+    tlqueue_t *tlq = malloc(sizeof(tlqueue_t));
+    if (!tlq)
+        return NULL;
+
+    list_ele_t *dummy = create_element(NULL);
+    if (!dummy) {
+        free(tlq);
+        return NULL;
+    }
+
+    pthread_mutex_init(&tlq->head_lock, NULL);
+    pthread_mutex_init(&tlq->tail_lock, NULL);
+    tlq->head = dummy;
+    tlq->tail = dummy;
+    tlq->size = 0;
+
+    return tlq;
+}
+
+void tlq_free(tlqueue_t *tlq)
+{
+    if (!tlq)
+        return;
+
+    /* The dummy holds no value, its string went with its removal */
+    list_ele_t *e = tlq->head;
+    while (e) {
+        list_ele_t *next = e->next;
+        free(e->value);
+        free(e);
+        e = next;
+    }
+
+    pthread_mutex_destroy(&tlq->head_lock);
+    pthread_mutex_destroy(&tlq->tail_lock);
+    free(tlq);
+}
+
+bool tlq_insert_tail(tlqueue_t *tlq, char *s)
+{
+    if (!tlq)
+        return false;
+
+    /* Allocate outside the lock, which then only guards two stores */
+    list_ele_t *e = create_element(s);
+    if (!e)
+        return false;
+
+    /* Count first, so that a racing removal never wraps size below zero */
+    __atomic_fetch_add(&tlq->size, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&tlq->tail_lock);
+    LINK(tlq->tail, e);
+    tlq->tail = e;
+    pthread_mutex_unlock(&tlq->tail_lock);
+
+    return true;
+}
+
+bool tlq_remove_head(tlqueue_t *tlq, char *sp, size_t bufsize)
+{
+    if (!tlq)
+        return false;
+
+    pthread_mutex_lock(&tlq->head_lock);
+    list_ele_t *dummy = tlq->head;
+    list_ele_t *first = NEXT(dummy);
+    if (!first) {
+        pthread_mutex_unlock(&tlq->head_lock);
+        return false;
+    }
+
+    /* first becomes the dummy, its value now belongs to us */
+    char *value = first->value;
+    first->value = NULL;
+    tlq->head = first;
+    pthread_mutex_unlock(&tlq->head_lock);
+
+    __atomic_fetch_sub(&tlq->size, 1, __ATOMIC_RELAXED);
+
+    if (sp) {
+        strncpy(sp, value, bufsize - 1);
+        sp[bufsize - 1] = '\0';
+    }
+    free(value);
+    free(dummy);
+
+    return true;
+}
+
+size_t tlq_size(tlqueue_t *tlq)
+{
+    return tlq ? __atomic_load_n(&tlq->size, __ATOMIC_RELAXED) : 0;
+}
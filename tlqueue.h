@@ -0,0 +1,70 @@
+#ifndef LAB0_TLQUEUE_H
+#define LAB0_TLQUEUE_H
+
+/*
+ * Two-lock concurrent queue after Michael and Scott.
+ *
+ * The chain of list_ele_t always starts with a dummy element, so the head
+ * and the tail never share an element that both ends would modify:
+ * insertions only take the tail lock and append behind the last element,
+ * removals only take the head lock and make the first real element the new
+ * dummy.  One producer and one consumer thus never wait for each other.
+ * Each end is kept a whole cache line away from anything else, and the size
+ * is kept with atomic instructions rather than under either lock.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cacheline.h"
+#include "queue.h"
+
+typedef struct {
+    CACHE_GAP(pad0);
+    pthread_mutex_t head_lock;
+    list_ele_t *head; /* The dummy element */
+    CACHE_GAP(pad1);
+    pthread_mutex_t tail_lock;
+    list_ele_t *tail; /* Last element, the dummy when empty */
+    CACHE_GAP(pad2);
+    size_t size;
+} tlqueue_t;
+
+/*
+ * Create empty queue.
+ * Return NULL if could not allocate space.
+ */
+tlqueue_t *tlq_new();
+
+/*
+ * Free ALL storage used by queue.  No thread may be using it.
+ * No effect if tlq is NULL
+ */
+void tlq_free(tlqueue_t *tlq);
+
+/*
+ * Attempt to insert element at tail of queue, holding the tail lock only.
+ * Return true if successful.
+ * Return false if tlq is NULL or could not allocate space.
+ * Argument s points to the string to be stored.
+ */
+bool tlq_insert_tail(tlqueue_t *tlq, char *s);
+
+/*
+ * Attempt to remove element from head of queue, holding the head lock only.
+ * Return true if successful.
+ * Return false if tlq is NULL or empty.
+ * If sp is non-NULL and an element is removed, copy the removed string to *sp
+ * (up to a maximum of bufsize-1 characters, plus a null terminator.)
+ * The space used by the list element and the string is freed.
+ */
+bool tlq_remove_head(tlqueue_t *tlq, char *sp, size_t bufsize);
+
+/*
+ * Return number of elements in queue.
+ * Return 0 if tlq is NULL or empty
+ */
+size_t tlq_size(tlqueue_t *tlq);
+
+#endif /* LAB0_TLQUEUE_H */
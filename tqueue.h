@@ -0,0 +1,186 @@
+#ifndef LAB0_TQUEUE_H
+#define LAB0_TQUEUE_H
+
+/*
+ * Typed queues, generated by macro for any value type.
+ *
+ * queue_t only holds strings, so integers or structs have to be formatted
+ * into one allocation and parsed back out.  QUEUE_DEFINE(name, type, cmp)
+ * instead defines name_t, a queue storing each value inside its element,
+ * and static functions name_new, name_free, name_insert_head,
+ * name_insert_tail, name_remove_head, name_size, name_reverse and
+ * name_sort, which follow the contracts of their q_ counterparts.
+ * cmp(a, b) takes two values and returns a negative number, zero or a
+ * positive number as a sorts before, with or after b; the sort calls it
+ * directly, so a static inline function or a macro gets inlined.
+ *
+ * The elements come from malloc, which harness.h redirects to the test
+ * allocator when included first.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define QUEUE_DEFINE(name, type, cmp)                                         \
+    typedef struct name##_ele {                                               \
+        type value;                                                           \
+        struct name##_ele *next;                                              \
+    } name##_ele_t;                                                           \
+                                                                              \
+    typedef struct {                                                          \
+        name##_ele_t *head;                                                   \
+        name##_ele_t *tail;                                                   \
+        size_t size;                                                          \
+    } name##_t;                                                               \
+                                                                              \
+    static inline name##_t *name##_new()                                      \
+    {                                                                         \
+        name##_t *q = malloc(sizeof(name##_t));                               \
+        if (!q)                                                               \
+            return NULL;                                                      \
+                                                                              \
+        q->head = NULL;                                                       \
+        q->tail = NULL;                                                       \
+        q->size = 0;                                                          \
+                                                                              \
+        return q;                                                             \
+    }                                                                         \
+                                                                              \
+    static inline void name##_free(name##_t *q)                               \
+    {                                                                         \
+        if (!q)                                                               \
+            return;                                                           \
+                                                                              \
+        while (q->head) {                                                     \
+            name##_ele_t *e = q->head;                                        \
+            q->head = e->next;                                                \
+            free(e);                                                          \
+        }                                                                     \
+        free(q);                                                              \
+    }                                                                         \
+                                                                              \
+    static inline bool name##_insert_head(name##_t *q, type v)                \
+    {                                                                         \
+        if (!q)                                                               \
+            return false;                                                     \
+                                                                              \
+        name##_ele_t *e = malloc(sizeof(name##_ele_t));                       \
+        if (!e)                                                               \
+            return false;                                                     \
+                                                                              \
+        e->value = v;                                                         \
+        e->next = q->head;                                                    \
+        q->head = e;                                                          \
+        if (!q->tail)                                                         \
+            q->tail = e;                                                      \
+        q->size++;                                                            \
+                                                                              \
+        return true;                                                          \
+    }                                                                         \
+                                                                              \
+    static inline bool name##_insert_tail(name##_t *q, type v)                \
+    {                                                                         \
+        if (!q)                                                               \
+            return false;                                                     \
+                                                                              \
+        name##_ele_t *e = malloc(sizeof(name##_ele_t));                       \
+        if (!e)                                                               \
+            return false;                                                     \
+                                                                              \
+        e->value = v;                                                         \
+        e->next = NULL;                                                       \
+        if (q->tail)                                                          \
+            q->tail->next = e;                                                \
+        else                                                                  \
+            q->head = e;                                                      \
+        q->tail = e;                                                          \
+        q->size++;                                                            \
+                                                                              \
+        return true;                                                          \
+    }                                                                         \
+                                                                              \
+    /* If vp is non-NULL and an element is removed, store its value there */  \
+    static inline bool name##_remove_head(name##_t *q, type *vp)              \
+    {                                                                         \
+        if (!q || !q->head)                                                   \
+            return false;                                                     \
+                                                                              \
+        name##_ele_t *e = q->head;                                            \
+        if (vp)                                                               \
+            *vp = e->value;                                                   \
+        q->head = e->next;                                                    \
+        if (!q->head)                                                         \
+            q->tail = NULL;                                                   \
+        q->size--;                                                            \
+        free(e);                                                              \
+                                                                              \
+        return true;                                                          \
+    }                                                                         \
+                                                                              \
+    static inline size_t name##_size(name##_t *q)                             \
+    {                                                                         \
+        return q ? q->size : 0;                                               \
+    }                                                                         \
+                                                                              \
+    static inline void name##_reverse(name##_t *q)                            \
+    {                                                                         \
+        if (!q || q->size < 2)                                                \
+            return;                                                           \
+                                                                              \
+        name##_ele_t *prev = NULL, *e = q->head;                              \
+        q->tail = e;                                                          \
+        while (e) {                                                           \
+            name##_ele_t *next = e->next;                                     \
+            e->next = prev;                                                   \
+            prev = e;                                                         \
+            e = next;                                                         \
+        }                                                                     \
+        q->head = prev;                                                       \
+    }                                                                         \
+                                                                              \
+    /* Merge two sorted lists, taking from a first on ties */                 \
+    static inline name##_ele_t *name##_merge(name##_ele_t *a,                 \
+                                             name##_ele_t *b)                 \
+    {                                                                         \
+        name##_ele_t *head = NULL, **link = &head;                            \
+        while (a && b) {                                                      \
+            name##_ele_t **from = cmp(a->value, b->value) <= 0 ? &a : &b;     \
+            *link = *from;                                                    \
+            link = &(*from)->next;                                            \
+            *from = (*from)->next;                                            \
+        }                                                                     \
+        *link = a ? a : b;                                                    \
+                                                                              \
+        return head;                                                          \
+    }                                                                         \
+                                                                              \
+    static inline name##_ele_t *name##_do_sort(name##_ele_t *e, size_t size)  \
+    {                                                                         \
+        if (size < 2)                                                         \
+            return e;                                                         \
+                                                                              \
+        name##_ele_t *last = e;                                               \
+        for (size_t i = 1; i < size / 2; i++)                                 \
+            last = last->next;                                                \
+        name##_ele_t *b = last->next;                                         \
+        last->next = NULL;                                                    \
+                                                                              \
+        return name##_merge(name##_do_sort(e, size / 2),                      \
+                            name##_do_sort(b, size - size / 2));              \
+    }                                                                         \
+                                                                              \
+    /* Stable merge sort in ascending order of cmp */                         \
+    static inline void name##_sort(name##_t *q)                               \
+    {                                                                         \
+        if (!q || q->size < 2)                                                \
+            return;                                                           \
+                                                                              \
+        q->head = name##_do_sort(q->head, q->size);                           \
+        name##_ele_t *e = q->head;                                            \
+        while (e->next)                                                       \
+            e = e->next;                                                      \
+        q->tail = e;                                                          \
+    }
+
+#endif /* LAB0_TQUEUE_H */
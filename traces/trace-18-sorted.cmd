@@ -0,0 +1,46 @@
+# Test of insertion in sorted mode
+option fail 0
+option malloc 0
+new
+ih gerbil
+ih bear
+it meerkat
+sorted
+ih dolphin
+it aardvark
+ih zebra
+it bear
+rh aardvark
+rh bear
+rh bear
+rh dolphin
+rh gerbil
+reverse
+it jaguar
+rh zebra
+sorted
+rh jaguar
+rh meerkat
+free
+new
+sorted
+ih RAND 200000
+it RAND 200000
+sort
+rhq
+rhq
+size
+free
+new
+ih bear 20000
+sorted
+it ant 20000
+it bear 20000
+index
+rv bear
+rv bear
+rv ant
+it cat
+rv bear
+size
+free
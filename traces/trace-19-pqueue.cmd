@@ -0,0 +1,27 @@
+# Test of priority queue operations
+option fail 0
+option malloc 0
+pnew
+pins gerbil
+pins bear
+pins meerkat
+pins dolphin
+pins bear
+ppeek bear
+psize
+prm bear
+prm bear
+prm dolphin
+pins aardvark
+prm aardvark
+prm gerbil
+prm meerkat
+psize
+pfree
+pnew
+pins RAND 100000
+prm
+prm
+prm
+psize
+pfree
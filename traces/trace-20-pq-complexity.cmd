@@ -0,0 +1,5 @@
+# Test if pq_insert and pq_remove_min are logarithmic time complexity
+option simulation 1
+pins
+prm
+option simulation 0
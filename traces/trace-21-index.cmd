@@ -0,0 +1,38 @@
+# Test of lookup and removal by value through the hash index
+option fail 0
+option malloc 0
+new
+ih gerbil
+ih bear
+it meerkat
+it dolphin
+rv meerkat
+index
+rv bear
+it jaguar
+ih bear
+rv dolphin
+reverse
+rv jaguar
+rh gerbil
+rh bear
+ih zebra
+ih aardvark
+it bear
+sort
+rv bear
+rh aardvark
+rh zebra
+free
+new
+sorted
+index
+ih meerkat
+ih bear
+it dolphin
+ih bear
+rv bear
+rv meerkat
+rh bear
+rh dolphin
+free
@@ -0,0 +1,17 @@
+# Test performance of lookup and removal by value
+# Scanning a million elements ten times takes as long as a million lookups
+# through the hash index
+option fail 0
+option malloc 0
+new
+ih RAND 500000
+it needle
+ih dolphin 500000
+time find needle 10
+index
+time find needle 1000000
+time find missing 1000000
+rv needle
+rv dolphin
+size
+free
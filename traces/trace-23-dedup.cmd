@@ -0,0 +1,52 @@
+# Test of removing duplicate values
+option fail 0
+option malloc 0
+new
+dedup
+ih gerbil
+it bear
+it gerbil
+it dolphin
+it bear
+it gerbil
+dedup
+rh gerbil
+rh bear
+rh dolphin
+size
+it bear
+it meerkat
+it bear
+ih meerkat
+ih dolphin
+dedup last
+rh dolphin
+rh meerkat
+rh bear
+free
+new
+sorted
+index
+ih meerkat
+ih bear
+it meerkat
+ih bear
+it aardvark
+ih meerkat
+dedup last
+find bear
+rh aardvark
+rh bear
+ih bear
+rh bear
+rh meerkat
+free
+new
+ih RAND 1000
+it dolphin 1000
+ih dolphin 1000
+reverse
+dedup
+sort
+dedup last
+free
@@ -0,0 +1,17 @@
+# Test performance of removing duplicate values
+# Two million elements holding two values are reduced in a single pass
+option fail 0
+option malloc 0
+new
+ih dolphin 1000000
+it gerbil 1000000
+dedup
+size
+rh dolphin
+rh gerbil
+new
+ih RAND 200000
+ih dolphin 200000
+index
+dedup last
+free
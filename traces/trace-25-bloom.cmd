@@ -0,0 +1,41 @@
+# Test of membership checks through the Bloom filter
+option fail 0
+option malloc 0
+new
+bloom
+contains gerbil
+ih gerbil
+it bear
+it dolphin
+contains bear
+contains meerkat
+bloom 0.001
+rv bear
+contains bear
+ih bear
+ih bear
+rh bear
+contains bear
+it RAND 200
+contains gerbil
+contains zebra
+dedup
+contains dolphin
+reverse
+sort
+contains gerbil
+index
+rv gerbil
+contains gerbil
+free
+new
+sorted
+bloom 0.1
+ih meerkat
+ih aardvark
+it zebra
+contains aardvark
+rh aardvark
+contains aardvark
+contains meerkat
+free
@@ -0,0 +1,15 @@
+# Test performance of membership checks that miss
+# Without an index every miss would scan half a million elements, but the
+# Bloom filter rules them out in constant time
+option fail 0
+option malloc 0
+new
+ih gerbil 250000
+it meerkat 250000
+bloom 0.01
+time contains missing 1000000
+time contains absent 1000000
+it needle 250000
+contains needle
+contains missing
+free
@@ -0,0 +1,43 @@
+# Test of sharing equal values through the interning pool
+option fail 0
+option malloc 0
+new
+ih gerbil
+it bear
+it gerbil
+intern
+ih bear
+it dolphin
+rh bear
+rh gerbil
+rh bear
+it gerbil
+sort
+rh dolphin
+rh gerbil
+rh gerbil
+size
+ih meerkat
+ih meerkat
+it zebra
+index
+rv meerkat
+dedup
+find meerkat
+reverse
+rh zebra
+rh meerkat
+free
+new
+intern
+sorted
+ih meerkat
+it aardvark
+ih meerkat
+bloom
+contains meerkat
+rh aardvark
+rh meerkat
+rh meerkat
+contains meerkat
+free
@@ -0,0 +1,17 @@
+# Test performance of inserting repeated values into an interned queue
+# The values of trace-15 are copied once each instead of a million times
+option fail 0
+option malloc 0
+new
+time ih dolphin 1000000
+time it gerbil 1000000
+free
+new
+intern
+time ih dolphin 1000000
+time it gerbil 1000000
+reverse
+sort
+intern
+size
+free
@@ -0,0 +1,73 @@
+# Test of copy-on-write snapshots
+option fail 0
+option malloc 0
+new
+snap
+snapcheck
+ih gerbil
+it bear
+it dolphin
+snap
+ih meerkat
+it zebra
+rh meerkat
+rh gerbil
+rh bear
+snapcheck
+it aardvark
+rh dolphin
+snapcheck
+snap
+reverse
+snapcheck
+rh aardvark
+it bear
+sort
+snapcheck
+rh bear
+snap
+ih gerbil
+ih gerbil
+dedup
+snapcheck
+index
+snap
+rv zebra
+snapcheck
+free
+snapcheck
+snapfree
+new
+intern
+sorted
+ih meerkat
+ih bear
+snap
+ih aardvark
+it zebra
+snapcheck
+rh aardvark
+rh bear
+snapcheck
+new
+snapcheck
+snapfree
+free
+new
+ih gerbil
+it bear
+snap
+rh gerbil
+ih meerkat
+free
+snapcheck
+snapfree
+new
+ih an_inline_value_of_23_ch
+ih a_heap_value_longer_than_inline
+snap
+rh
+intern
+snapcheck
+snapfree
+free
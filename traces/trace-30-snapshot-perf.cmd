@@ -0,0 +1,17 @@
+# Test performance of snapshots of a large queue
+# Taking a snapshot shares the million elements instead of copying them,
+# and inserts at either end stay as fast as without one
+option fail 0
+option malloc 0
+new
+ih dolphin 1000000
+it gerbil 1000000
+snap
+time ih meerkat 1000000
+snapcheck
+snap
+time it bear 1000000
+snapcheck
+free
+snapcheck
+snapfree
@@ -0,0 +1,10 @@
+# Test of the blocking queue under producer/consumer workloads
+# Every item must arrive exactly once, however many threads take part
+option fail 0
+option malloc 0
+bqbench 1 1 100000
+bqbench 1 4 100000
+bqbench 4 1 100000
+bqbench 4 4 100000
+bqbench 4 4 100000 16
+bqbench 8 8 100000 64
@@ -0,0 +1,7 @@
+# Test of the lock-free queue against a mutex-protected one
+# Every item must be removed exactly once, however many threads take part
+option fail 0
+option malloc 0
+lfbench 1 100000
+lfbench 4 100000
+lfbench 16 100000
@@ -0,0 +1,8 @@
+# Test of the single-producer/single-consumer ring
+# Items must arrive in order and exactly once, whatever the batch and size
+option fail 0
+option malloc 0
+spscbench 1000000
+spscbench 1000000 32
+spscbench 100000 64 1
+spscbench 100000 7 5
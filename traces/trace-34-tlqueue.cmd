@@ -0,0 +1,8 @@
+# Test of the two-lock queue against a single-lock one
+# Every item must arrive exactly once, however many threads take part
+option fail 0
+option malloc 0
+tlbench 1 1 100000
+tlbench 1 4 100000
+tlbench 4 1 100000
+tlbench 8 8 100000
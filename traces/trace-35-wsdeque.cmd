@@ -0,0 +1,8 @@
+# Test of the work-stealing deque through a parallel merge sort
+# Stolen halves must come back sorted, whatever the number of workers
+option fail 0
+option malloc 0
+wssort 1 100000
+wssort 2 100000
+wssort 8 300000
+wssort 64 50000
@@ -0,0 +1,7 @@
+# Test of the sharded relaxed queue against a single-lock one
+# Every item must be removed exactly once, however many shards there are
+option fail 0
+option malloc 0
+mqbench 1 100000
+mqbench 4 100000 1
+mqbench 16 100000 4
@@ -0,0 +1,63 @@
+# Test of bounded queues and their overflow policies
+option fail 0
+option malloc 0
+option capacity 3
+new
+ih a
+it b
+it c
+it d
+bounds
+rh a
+it d
+option policy 2
+it e
+it f
+bounds
+rh d
+rh e
+it g
+it h
+option policy 3
+ih z
+it y
+bounds
+rh f
+option policy 1
+it i
+it j
+bounds
+option capbytes 1
+option capacity 6
+option policy 2
+it xyz
+it abcdefgh
+bounds
+rh i
+rh xyz
+option capacity 0
+option capbytes 0
+it u
+it v
+it w
+it x
+size 4
+free
+option capacity 2
+option policy 2
+new
+it a_value_too_long_to_be_stored_inline
+it another_value_too_long_to_be_inline
+option fail 10
+option malloc 100
+it a_third_value_too_long_to_be_inline
+ih a_fourth_value_too_long_to_be_inline
+option malloc 0
+option fail 0
+size
+rh a_value_too_long_to_be_stored_inline
+free
+option capacity 8
+option policy 1
+bqbench 4 2 100000 1 8
+bqbench 2 4 100000 8 4
@@ -0,0 +1,28 @@
+# Test of the timing wheel: timers expire at their tick, in due order
+option fail 0
+option malloc 0
+wnew
+wadd 3 c
+wadd 1 a
+wadd 2 b
+wadd 64 x
+wadd 65 y
+wadd 0 now
+wadd 4096 z
+wadd 300000 far
+wadd 20000000 veryfar
+wtick
+wtick
+wtick 2
+wcancel 4
+wtick 100
+wtick 5000
+wcancel 7
+wtick 400000
+wtick 20000000
+wadd 1 next
+wtick 16000000
+wadd RAND r 1000
+wcancel 10 500
+wtick 300000
+wfree
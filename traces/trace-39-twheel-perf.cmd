@@ -0,0 +1,11 @@
+# Test performance of the timing wheel with a million timers
+# Scheduling and cancelling take constant time, and nothing is ever sorted
+option fail 0
+option malloc 0
+wnew
+time wadd RAND job 1000000
+time wcancel 0 250000
+time wtick 100000
+time wtick 200000
+time wadd 70000 late 500000
+time wfree
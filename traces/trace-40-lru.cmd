@@ -0,0 +1,38 @@
+# Test of the LRU cache: hits move to the front, evictions take the tail
+option fail 0
+option malloc 0
+lnew 3
+lput a 1
+lput b 2
+lput c 3
+lget a 1
+lput d 4
+lget b
+lget c 3
+lput a 10
+lget a 10
+lrm d
+lrm d
+lput e 5
+lput f 6
+lget c
+lget a 10
+lget e 5
+lget f 6
+lnew 16 bytes
+lput k1 aaaa
+lput k2 bbbb
+lget k1 aaaa
+lput k3 cc
+lget k2
+lget k1 aaaa
+lget k3 cc
+lput k3 c
+lget k3 c
+lput k4 ddd
+lget k1
+lget k3 c
+lget k4 ddd
+lfree
+lrubench 200000 10000 1000
+lrubench 1000000 100000 10000 1.2
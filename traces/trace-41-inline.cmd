@@ -0,0 +1,44 @@
+# Test of queues whose first elements are stored inline
+# Short and long values mix, and inline slots are reused after removals
+option fail 0
+option malloc 0
+new
+it a
+it thisvalueistoolongtobestoredinline
+ih b
+it c
+it d
+it e
+show
+rh b
+rh a
+ih f
+ih g
+reverse
+sort
+show
+index
+rv c
+find d
+snap
+rh d
+rh e
+it h
+snapcheck
+snapfree
+intern
+it h
+dedup
+show
+size
+free
+new
+it x 3
+intern
+rh x
+rh x
+ih yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy
+it z
+rh yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy
+free
+smallbench 100000
@@ -0,0 +1,10 @@
+# Test of element counts on a queue sized by the memory available
+# The count exceeds INT_MAX only on hosts with enough memory to spare
+option fail 0
+option malloc 0
+new
+it a 3
+size
+stress 10 8000000
+size
+free
@@ -0,0 +1,8 @@
+# Test of a typed queue of 64-bit values against the string queue
+# Both must agree after every phase, whatever the number of values
+option fail 0
+option malloc 0
+tqbench 1
+tqbench 2
+tqbench 7
+tqbench 100000
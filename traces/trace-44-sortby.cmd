@@ -0,0 +1,33 @@
+# Test of sorting in each order, each checked in its own order
+# Mixed case, numbers and equal values under some orders only
+option fail 0
+option malloc 0
+new
+it Banana
+it apple
+it 10
+it 9
+it -2.5
+it Cherry
+it Apple
+it x
+sort
+sort desc
+sort nocase
+sort numeric
+reverse
+sort numeric
+sorted
+it b
+sort desc
+it b
+sort asc
+show
+free
+new
+it 3
+it 1
+it 2
+sort numeric
+sort nocase
+free
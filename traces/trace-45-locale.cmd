@@ -0,0 +1,28 @@
+# Test of sorting in locale order by collation keys
+# Keys beyond the prefix kept, and sorting with no scratch memory to spare
+option fail 0
+option malloc 0
+locale C
+new
+it zebra
+it Zebra
+it apple
+it averyveryverylongwordthatoutgrowstheprefixb
+it averyveryverylongwordthatoutgrowstheprefix
+it averyveryverylongwordthatoutgrowstheprefixa
+it averyveryverylongwordth
+it apple
+sort locale
+sort desc
+sort collate
+sort desc
+option malloc 100
+sort locale
+option malloc 0
+sort desc
+snap
+sort locale
+snapcheck
+snapfree
+free
+localebench 100000
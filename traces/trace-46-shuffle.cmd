@@ -0,0 +1,39 @@
+# Test of shuffling queues, with the same seed giving the same order
+# Indexes, snapshots and sorted mode must follow the new order
+option fail 0
+option malloc 0
+new
+shuffle 1
+it a
+shuffle 1
+ih b
+it c
+it d
+it e
+it f
+shuffle 42
+shuffle 42
+sort
+shuffle 42
+index
+shuffle 7
+find c
+rv d
+sorted
+shuffle 3
+it a
+snap
+shuffle 5
+snapcheck
+snapfree
+option fail 10
+option malloc 100
+shuffle 9
+option malloc 0
+option fail 0
+free
+new
+it RAND 1000000
+shuffle 2024
+shuffle
+free
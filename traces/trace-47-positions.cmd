@@ -0,0 +1,83 @@
+# Test of access, deletion, rotation and split by position
+# Head and tail operations keep the index; others leave it to be rebuilt
+option fail 0
+option malloc 0
+new
+at 0
+pos
+it a
+it b
+it c
+ih z
+at 0
+at 3
+at 4
+rotate 1
+rotate 7
+delat 2
+option fail 10
+delat 5
+it d
+it e
+ih y
+at 2
+rh y
+rh z
+at 0
+reverse
+at 1
+sort
+delat 0
+sorted
+it bb
+at 1
+rv bb
+shuffle 3
+delat 1
+split 1
+split 5
+option fail 0
+free
+new
+it RAND 1000
+split 500
+rotate 250
+option fail 10
+split 200
+option fail 0
+rotate 250
+it RAND 100
+delat 300
+split 400
+free
+new
+pos
+it RAND 20000
+rotate 3000
+split 12345
+ih RAND 500
+it RAND 500
+delat 6000
+at 7777
+rotate 10000
+split 0
+it RAND 100
+free
+option capacity 100
+new
+it RAND 100
+split 60
+it RAND 40
+size
+it a
+option capacity 0
+free
+new
+it RAND 1000000
+pos
+at 500000 200000
+split 600000
+rotate 333333
+delat 577777
+at 599998 200000
+free
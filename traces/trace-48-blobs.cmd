@@ -0,0 +1,50 @@
+# Test of storing large values in a blob region shared by queues
+# Values from the region must move, split and go like heap ones
+option fail 0
+option malloc 0
+new
+it short
+blobs 16
+it a_value_long_enough_for_the_region
+ih another_value_long_enough_for_it
+it tiny
+ih yet_another_value_for_the_blob_region
+rh yet_another_value_for_the_blob_region
+reverse
+sort
+it a_value_long_enough_for_the_region
+dedup
+rotate 1
+index
+rv another_value_long_enough_for_it
+find a_value_long_enough_for_the_region
+snap
+rh short
+snapcheck
+snapfree
+it the_region_reuses_this_freed_slot
+blobs 16
+intern
+it interned_values_stay_in_the_pool
+blobs
+free
+new
+blobs 8
+pos
+it RAND 1000
+it the_last_value_of_many
+blobs 8
+shuffle 4
+sort
+rotate 500
+split 700
+snap
+free
+snapcheck
+snapfree
+new
+blobs
+blobbench 5000
+blobbench 50000 1 4096
+blobbench 200 20 1048576
+free
@@ -0,0 +1,79 @@
+# Test of freezing sorted queues into front-coded blocks and back
+# Strings must read back in order, across blocks and after removals
+option fail 0
+option malloc 0
+freeze
+thaw
+new
+freeze
+thaw
+it application
+it apple
+it applesauce
+it apply
+it apricot
+it banana
+it band
+it bandana
+it b
+it c
+sort
+freeze 3
+frh apple
+frh applesauce
+frh application
+thaw
+rh apply
+freeze 1
+frh apricot
+frh b
+frh banana
+frh band
+frh bandana
+frh c
+option fail 10
+frh
+option fail 0
+thaw
+free
+new
+it RAND 10000
+sort
+freeze
+frh
+frh
+thaw
+sort
+freeze 64
+thaw
+free
+new
+it /usr/share/doc/lab0-c/traces/trace-01-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-02-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-03-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-04-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-05-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-06-ops.cmd
+it /usr/share/doc/lab0-c/traces/trace-07-string.cmd
+it /usr/share/doc/lab0-c/traces/trace-08-robust.cmd
+it /usr/share/doc/lab0-c/traces/trace-09-robust.cmd
+it /usr/share/doc/lab0-c/traces/trace-10-robust.cmd
+it /usr/share/doc/lab0-c/traces/trace-11-malloc.cmd
+it /usr/share/doc/lab0-c/traces/trace-12-malloc.cmd
+sort
+freeze 8
+frh /usr/share/doc/lab0-c/traces/trace-01-ops.cmd
+thaw
+option fail 10
+option malloc 50
+freeze 2
+thaw
+option malloc 0
+option fail 0
+free
+new
+it RAND 400000
+sort
+freeze
+thaw
+free
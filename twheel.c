@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "twheel.h"
+
+/* Ticks covered by one slot of level l, and by a whole wheel of level l */
+#define SLOT_SPAN(l) ((uint64_t) 1 << (TW_BITS * (l)))
+#define WHEEL_SPAN(l) SLOT_SPAN((l) + 1)
+
+/******** Utility Zone ********/
+
+static inline int digit(uint64_t tick, int level)
+{
+    return (tick >> (TW_BITS * level)) & (TW_SLOTS - 1);
+}
+
+/* Link t where the clock will find it again, or onto the expired queue */
+static void place(twheel_t *tw, tw_timer_t *t)
+{
+    if (t->due <= tw->now) {
+        t->slot = tw->expired;
+        q_link_tail(tw->expired, &t->ele);
+        tw->pending--;
+        return;
+    }
+
+    int level = TW_LEVELS - 1;
+    int i = (digit(tw->now, level) - 1) & (TW_SLOTS - 1);
+    if (t->due - tw->now < WHEEL_SPAN(TW_LEVELS - 1)) {
+        /* The highest digit that differs is still ahead of the clock's */
+        uint64_t diff = t->due ^ tw->now;
+        level = 0;
+        while (level < TW_LEVELS - 1 && diff >= WHEEL_SPAN(level))
+            level++;
+        i = digit(t->due, level);
+    }
+
+    t->slot = tw->slots[level][i];
+    q_link_tail(t->slot, &t->ele);
+}
+
+/* Spread the timers of a slot the clock just reached over lower levels */
+static void cascade(twheel_t *tw, int level, int i)
+{
+    queue_t *slot = tw->slots[level][i];
+    while (slot->head) {
+        tw_timer_t *t = (tw_timer_t *) slot->head;
+        q_unlink(slot, &t->ele);
+        place(tw, t);
+    }
+}
+
+/* Advance the clock by one tick */
+static void tick(twheel_t *tw)
+{
+    tw->now++;
+    for (int l = TW_LEVELS - 1; l > 0; l--) {
+        if (tw->now % SLOT_SPAN(l) == 0)
+            cascade(tw, l, digit(tw->now, l));
+    }
+
+    queue_t *slot = tw->slots[0][digit(tw->now, 0)];
+    tw->pending -= q_size(slot);
+    q_splice_tail(tw->expired, slot);
+}
+
+/******** End of Utility Zone ********/
+
+twheel_t *tw_new()
+{
+    twheel_t *tw = malloc(sizeof(twheel_t));
+    if (!tw)
+        return NULL;
+
+    memset(tw, 0, sizeof(twheel_t));
+    tw->expired = q_new();
+    bool ok = tw->expired != NULL;
+    for (int l = 0; ok && l < TW_LEVELS; l++) {
+        for (int i = 0; ok && i < TW_SLOTS; i++) {
+            tw->slots[l][i] = q_new();
+            ok = tw->slots[l][i] != NULL;
+        }
+    }
+    if (!ok) {
+        tw_free(tw);
+        return NULL;
+    }
+
+    return tw;
+}
+
+void tw_free(twheel_t *tw)
+{
+    if (!tw)
+        return;
+
+    /* Timers start with their element, so the queues free them whole */
+    for (int l = 0; l < TW_LEVELS; l++) {
+        for (int i = 0; i < TW_SLOTS; i++)
+            q_free(tw->slots[l][i]);
+    }
+    q_free(tw->expired);
+    free(tw);
+}
+
+tw_timer_t *tw_schedule(twheel_t *tw, uint64_t delay, char *s)
+{
+    if (!tw)
+        return NULL;
+
+    tw_timer_t *t = malloc(sizeof(tw_timer_t));
+    if (!t)
+        return NULL;
+
+    t->ele.value = strdup(s);
+    if (!t->ele.value) {
+        free(t);
+        return NULL;
+    }
+    t->ele.sib_next = NULL;
+    t->ele.sib_prev = NULL;
+
+    /* A due time past the end of the clock is as good as never */
+    t->due = delay > UINT64_MAX - tw->now ? UINT64_MAX : tw->now + delay;
+    tw->pending++;
+    place(tw, t);
+
+    return t;
+}
+
+bool tw_cancel(twheel_t *tw, tw_timer_t *t)
+{
+    if (!tw || !t)
+        return false;
+
+    if (t->due <= tw->now) {
+        q_unlink(tw->expired, &t->ele);
+    } else {
+        q_unlink(t->slot, &t->ele);
+        tw->pending--;
+    }
+    free(t->ele.value);
+    free(t);
+
+    return true;
+}
+
+size_t tw_advance(twheel_t *tw, uint64_t ticks)
+{
+    if (!tw)
+        return 0;
+
+    size_t before = q_size(tw->expired);
+    for (uint64_t i = 0; i < ticks; i++) {
+        /* An empty wheel has nothing to cascade or expire */
+        if (tw->pending == 0) {
+            tw->now += ticks - i;
+            break;
+        }
+        tick(tw);
+    }
+
+    return q_size(tw->expired) - before;
+}
+
+bool tw_pop(twheel_t *tw, char *sp, size_t bufsize, uint64_t *due)
+{
+    if (!tw || !tw->expired->head)
+        return false;
+
+    if (due)
+        *due = ((tw_timer_t *) tw->expired->head)->due;
+
+    return q_remove_head(tw->expired, sp, bufsize);
+}
+
+size_t tw_pending(twheel_t *tw)
+{
+    return tw ? tw->pending : 0;
+}
@@ -0,0 +1,95 @@
+#ifndef LAB0_TWHEEL_H
+#define LAB0_TWHEEL_H
+
+/*
+ * Delay queue of strings, each due at a given tick of a simulated clock.
+ *
+ * It uses a hierarchical timing wheel: TW_LEVELS wheels of TW_SLOTS slots,
+ * each slot a plain queue_t.  A slot of level l covers 64^l ticks, so a
+ * timer goes to the level of the highest base-64 digit in which its due
+ * time differs from the current time, into the slot of that digit.
+ * Scheduling and cancelling are O(1).  When the clock reaches the start of
+ * a slot on an upper level, its timers are cascaded down to the level that
+ * fits them now; every level-0 slot reached has expired and is spliced as a
+ * whole onto the expired queue, where the caller collects the values in
+ * due order.  Nothing is ever sorted.
+ *
+ * Timers further away than the wheels reach wait in the last slot of the
+ * top level to come round, which cascades them again.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queue.h"
+
+#define TW_BITS 6
+#define TW_SLOTS (1 << TW_BITS)
+#define TW_LEVELS 4
+
+/* Scheduled string, also the handle to cancel it */
+typedef struct {
+    list_ele_t ele; /* Element linked into a slot, so it must come first */
+    uint64_t due;   /* Tick at which it expires */
+    queue_t *slot;  /* Slot holding it while pending */
+} tw_timer_t;
+
+typedef struct {
+    uint64_t now;     /* Current tick */
+    size_t pending;   /* Number of timers not expired yet */
+    queue_t *expired; /* Expired timers, in due order */
+    queue_t *slots[TW_LEVELS][TW_SLOTS];
+} twheel_t;
+
+/*
+ * Create empty timing wheel, its clock at tick 0.
+ * Return NULL if could not allocate space.
+ */
+twheel_t *tw_new();
+
+/*
+ * Free ALL storage used by timing wheel, including the timers still in it.
+ * No effect if tw is NULL
+ */
+void tw_free(twheel_t *tw);
+
+/*
+ * Schedule a copy of s to expire delay ticks from now.  A delay of 0 makes
+ * it expire at once.
+ * Return the timer, which stays valid until cancelled or popped.
+ * Return NULL if tw is NULL or could not allocate space.
+ */
+tw_timer_t *tw_schedule(twheel_t *tw, uint64_t delay, char *s);
+
+/*
+ * Cancel timer t, pending or expired but not popped yet, and free it.
+ * Return false if tw or t is NULL.
+ */
+bool tw_cancel(twheel_t *tw, tw_timer_t *t);
+
+/*
+ * Advance the clock by ticks, moving every timer that falls due onto the
+ * expired queue.
+ * Return number of timers that expired.
+ */
+size_t tw_advance(twheel_t *tw, uint64_t ticks);
+
+/*
+ * Attempt to remove the earliest expired timer.
+ * Return true if successful.
+ * Return false if tw is NULL or nothing has expired.
+ * If sp is non-NULL and a timer is removed, copy its string to *sp (up to a
+ * maximum of bufsize-1 characters, plus a null terminator.)  If due is
+ * non-NULL, store the tick the timer was due at.
+ * The timer is freed.
+ */
+bool tw_pop(twheel_t *tw, char *sp, size_t bufsize, uint64_t *due);
+
+/*
+ * Return number of pending timers.
+ * Return 0 if tw is NULL
+ */
+size_t tw_pending(twheel_t *tw);
+
+#endif /* LAB0_TWHEEL_H */
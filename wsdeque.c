@@ -0,0 +1,162 @@
+#include <stdlib.h>
+
+#include "harness.h"
+#include "wsdeque.h"
+
+/*
+ * Every shared access is sequentially consistent, which the algorithm
+ * needs where the owner's pop and a thief's steal race for the last item.
+ */
+#define LOAD(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define STORE(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define CAS(p, expected, desired)                                  \
+    __extension__({                                                \
+        __typeof__(*(p)) __exp = (expected);                       \
+        __atomic_compare_exchange_n(p, &__exp, desired, false,     \
+                                    __ATOMIC_SEQ_CST,              \
+                                    __ATOMIC_SEQ_CST);             \
+    })
+
+/******** Utility Zone ********/
+
+static wsq_array_t *create_array(long capacity)
+{
+    wsq_array_t *a = malloc(sizeof(wsq_array_t) + capacity * sizeof(void *));
+    if (!a)
+        return NULL;
+
+    a->capacity = capacity;
+    a->older = NULL;
+
+    return a;
+}
+
+static inline void *get_slot(wsq_array_t *a, long i)
+{
+    return LOAD(&a->slots[i & (a->capacity - 1)]);
+}
+
+static inline void set_slot(wsq_array_t *a, long i, void *item)
+{
+    STORE(&a->slots[i & (a->capacity - 1)], item);
+}
+
+/* Owner: move items top to bottom - 1 into an array twice as large */
+static wsq_array_t *grow(wsdeque_t *dq, wsq_array_t *a, long top, long bottom)
+{
+    wsq_array_t *bigger = create_array(a->capacity * 2);
+    if (!bigger)
+        return NULL;
+
+    for (long i = top; i < bottom; i++)
+        set_slot(bigger, i, get_slot(a, i));
+    bigger->older = a;
+    STORE(&dq->array, bigger);
+
+    return bigger;
+}
+
+/******** End of Utility Zone ********/
+
+wsdeque_t *wsq_new(int capacity)
+{
+    long size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    wsdeque_t *dq = malloc(sizeof(wsdeque_t));
+    if (!dq)
+        return NULL;
+
+    dq->array = create_array(size);
+    if (!dq->array) {
+        free(dq);
+        return NULL;
+    }
+    dq->top = 0;
+    dq->bottom = 0;
+
+    return dq;
+}
+
+void wsq_free(wsdeque_t *dq)
+{
+    if (!dq)
+        return;
+
+    wsq_array_t *a = dq->array;
+    while (a) {
+        wsq_array_t *older = a->older;
+        free(a);
+        a = older;
+    }
+    free(dq);
+}
+
+bool wsq_push(wsdeque_t *dq, void *item)
+{
+    long bottom = LOAD(&dq->bottom);
+    long top = LOAD(&dq->top);
+    wsq_array_t *a = LOAD(&dq->array);
+    if (bottom - top >= a->capacity) {
+        a = grow(dq, a, top, bottom);
+        if (!a)
+            return false;
+    }
+
+    /* The item must be in place before a thief can see the new bottom */
+    set_slot(a, bottom, item);
+    STORE(&dq->bottom, bottom + 1);
+
+    return true;
+}
+
+void *wsq_pop(wsdeque_t *dq)
+{
+    /* Claim the bottom item first, then look whether thieves got near */
+    long bottom = LOAD(&dq->bottom) - 1;
+    wsq_array_t *a = LOAD(&dq->array);
+    STORE(&dq->bottom, bottom);
+    long top = LOAD(&dq->top);
+
+    if (top > bottom) {
+        STORE(&dq->bottom, bottom + 1);
+        return NULL;
+    }
+
+    void *item = get_slot(a, bottom);
+    if (top == bottom) {
+        /* The last item: win it against the thieves or leave it to them */
+        if (!CAS(&dq->top, top, top + 1))
+            item = NULL;
+        STORE(&dq->bottom, bottom + 1);
+    }
+
+    return item;
+}
+
+wsq_status_t wsq_steal(wsdeque_t *dq, void **item)
+{
+    long top = LOAD(&dq->top);
+    long bottom = LOAD(&dq->bottom);
+    if (top >= bottom)
+        return WSQ_EMPTY;
+
+    /* Read before claiming: once top moves the owner may reuse the slot */
+    wsq_array_t *a = LOAD(&dq->array);
+    void *stolen = get_slot(a, top);
+    if (!CAS(&dq->top, top, top + 1))
+        return WSQ_ABORT;
+
+    *item = stolen;
+    return WSQ_OK;
+}
+
+long wsq_size(wsdeque_t *dq)
+{
+    /* A pop racing with a steal may briefly put top past bottom */
+    long bottom = LOAD(&dq->bottom);
+    long top = LOAD(&dq->top);
+
+    return bottom > top ? bottom - top : 0;
+}
@@ -0,0 +1,77 @@
+#ifndef LAB0_WSDEQUE_H
+#define LAB0_WSDEQUE_H
+
+/*
+ * Work-stealing deque after Chase and Lev.
+ *
+ * One owner thread pushes and pops items at the bottom end, as with a
+ * stack, while any number of thieves take items from the top end.  The
+ * owner only needs an atomic instruction when it competes with thieves for
+ * the very last item; a thief claims an item by advancing the top index
+ * with a compare-and-swap, and simply reports the loss when another thread
+ * got there first.  The items live in a circular array that the owner
+ * doubles when it fills up.  A thief may still be reading an outgrown
+ * array, so those are only freed with the deque.
+ */
+
+#include <stdbool.h>
+
+#include "cacheline.h"
+
+/* Outcome of wsq_steal */
+typedef enum { WSQ_OK, WSQ_EMPTY, WSQ_ABORT } wsq_status_t;
+
+typedef struct wsq_array {
+    long capacity; /* Always a power of two */
+    struct wsq_array *older; /* Array this one replaced */
+    void *slots[];
+} wsq_array_t;
+
+typedef struct {
+    long top; /* Next item to steal, advanced by thieves */
+    CACHE_PAD(pad0, sizeof(long));
+    long bottom; /* Next free slot, moved by the owner */
+    wsq_array_t *array;
+    CACHE_PAD(pad1, sizeof(long) + sizeof(wsq_array_t *));
+} wsdeque_t;
+
+/*
+ * Create empty deque with room for capacity items before it grows.
+ * Return NULL if could not allocate space.
+ */
+wsdeque_t *wsq_new(int capacity);
+
+/*
+ * Free ALL storage used by deque, but not the items.  No thread may be
+ * using it.  No effect if dq is NULL
+ */
+void wsq_free(wsdeque_t *dq);
+
+/*
+ * Owner: push item at the bottom.
+ * Return false if the deque was full and could not grow.
+ */
+bool wsq_push(wsdeque_t *dq, void *item);
+
+/*
+ * Owner: pop the item pushed last.
+ * Return NULL if the deque is empty.
+ */
+void *wsq_pop(wsdeque_t *dq);
+
+/*
+ * Thief: take the item pushed first into *item.
+ * Return WSQ_OK if successful.
+ * Return WSQ_EMPTY if the deque is empty.
+ * Return WSQ_ABORT if another thread took that item first, in which case
+ * trying again may succeed.
+ */
+wsq_status_t wsq_steal(wsdeque_t *dq, void **item);
+
+/*
+ * Return number of items in deque, which is only a snapshot while other
+ * threads use it.
+ */
+long wsq_size(wsdeque_t *dq);
+
+#endif /* LAB0_WSDEQUE_H */